@@ -6,8 +6,18 @@ using namespace std;
 /* andrew.spriggs@csiro.au */
 /* https://github.com/spriggsy83 */
 
+/*** Aligned read without qualities, all positions given maxQual
+**/
 AlignedRead::AlignedRead(const string& newSeq, int newStart, int newEnd){
-	sequence = newSeq;
+	packSeq(newSeq, "");
+	alignedStart = newStart;
+	alignedEnd = newEnd;
+}
+
+/*** Aligned read with SAM/FASTQ Phred+33 qualities, ' ' in sequence for a deleted base
+**/
+AlignedRead::AlignedRead(const string& newSeq, const string& newQual, int newStart, int newEnd){
+	packSeq(newSeq, newQual);
 	alignedStart = newStart;
 	alignedEnd = newEnd;
 }
@@ -27,6 +37,51 @@ AlignedRead& AlignedRead::operator= (const AlignedRead& copySource){
 	return *this;
 }
 
+void AlignedRead::packSeq(const string& newSeq, const string& newQual){
+	const bool hasQual = (newQual.length() == newSeq.length());
+	sequence.resize(newSeq.length());
+	for(int i=0; i<newSeq.length(); i++){
+		unsigned char code;
+		switch(newSeq[i]){
+			case 'A':
+			case 'a':
+				code = 0;
+				break;
+			case 'T':
+			case 't':
+				code = 1;
+				break;
+			case 'C':
+			case 'c':
+				code = 2;
+				break;
+			case 'G':
+			case 'g':
+				code = 3;
+				break;
+			case 'N':
+			case 'n':
+				code = codeN;
+				break;
+			case ' ':
+				code = codeDel;
+				break;
+			default:
+				code = codeOther;
+		}
+		int q = maxQual;
+		if(hasQual && code != codeDel){
+			q = int(newQual[i]) - 33;
+			if(q < 0){
+				q = 0;
+			}else if(q > maxQual){
+				q = maxQual;
+			}
+		}
+		sequence[i] = (char)(code | (q << qualShift));
+	}
+}
+
 int AlignedRead::start() const{
 	return alignedStart;
 }
@@ -35,15 +90,35 @@ int AlignedRead::end() const{
 	return alignedEnd;
 }
 
-const char& AlignedRead::operator[] (int i) const{
-	return sequence[i];
+/*** Base at a position of the read, as a character
+**/
+char AlignedRead::operator[] (int i) const{
+	static const char codeBases[8] = {'A', 'T', 'C', 'G', 'N', ' ', '?', '?'};
+	return codeBases[(unsigned char)sequence[i] & baseMask];
+}
+
+/*** Packed base code and quality at a position of the read
+**/
+unsigned char AlignedRead::packed(int i) const{
+	return (unsigned char)sequence[i];
+}
+
+int AlignedRead::qual(int i) const{
+	return (unsigned char)sequence[i] >> qualShift;
 }
 
 string AlignedRead::getSeq() const{
-	return sequence;
+	string result(sequence.length(), ' ');
+	for(int i=0; i<sequence.length(); i++){
+		result[i] = (*this)[i];
+	}
+	return result;
+}
+
+size_t AlignedRead::memBytes() const{
+	return sizeof(AlignedRead) + sequence.capacity();
 }
 
 bool AlignedRead::operator < (const AlignedRead& otherRead) const{
 	return (alignedStart < otherRead.alignedStart);
 }
-
@@ -8,20 +8,36 @@ using namespace std;
 /* andrew.spriggs@csiro.au */
 /* https://github.com/spriggsy83 */
 
+/*** An aligned read (or intron-separated block of one), with bases and Phred qualities packed a byte per position.
+** Low 3 bits hold the base code (0 = A, 1 = T, 2 = C, 3 = G, 4 = N, 5 = deletion, 6 = other), high 5 bits the quality, capped at maxQual.
+**/
 class AlignedRead {
-	string sequence;
+	string sequence; //!< Packed base code and quality per aligned position
 	int alignedStart;
 	int alignedEnd;
 	
+	void packSeq(const string&, const string&);
+	
   public:
+	static const int maxQual = 31; //!< Largest quality held in packed form, higher scores are capped to this
+	static const unsigned char baseMask = 7; //!< Mask for base code from a packed position
+	static const int qualShift = 3; //!< Shift for quality from a packed position
+	static const unsigned char codeN = 4; //!< Base code for N
+	static const unsigned char codeDel = 5; //!< Base code for deletion
+	static const unsigned char codeOther = 6; //!< Base code for other (ambiguous) bases
+	
 	AlignedRead(const string&, int, int);
+	AlignedRead(const string&, const string&, int, int);
 	AlignedRead(const AlignedRead&);
 	AlignedRead& operator= (const AlignedRead&);
 	bool operator < (const AlignedRead& otherRead) const;
 	int start() const;
 	int end() const;
-	const char& operator[] (int i) const;
+	char operator[] (int i) const;
+	unsigned char packed(int i) const;
+	int qual(int i) const;
 	string getSeq() const;
+	size_t memBytes() const;
 };
 
 #endif
@@ -0,0 +1,107 @@
+#include <cstddef>
+#include <cstring>
+#include "BaseComposition.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BASECOMPOSITION_X86
+#endif
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/*** Base type of each character
+**/
+struct BaseTypeTable {
+	unsigned char baseTypes[256];
+	BaseTypeTable(){
+		memset(baseTypes, BaseComposition::baseOther, sizeof(baseTypes));
+		baseTypes[(unsigned char)'A'] = baseTypes[(unsigned char)'a'] = BaseComposition::baseA;
+		baseTypes[(unsigned char)'C'] = baseTypes[(unsigned char)'c'] = BaseComposition::baseC;
+		baseTypes[(unsigned char)'G'] = baseTypes[(unsigned char)'g'] = BaseComposition::baseG;
+		baseTypes[(unsigned char)'T'] = baseTypes[(unsigned char)'t'] = BaseComposition::baseT;
+		baseTypes[(unsigned char)'N'] = baseTypes[(unsigned char)'n'] = BaseComposition::baseN;
+	}
+};
+static const BaseTypeTable baseTypeTable;
+
+/*** Count a sequence's bases, by the fastest kernel this CPU supports
+**/
+void BaseComposition::countBases(const char* seq, size_t seqLen, unsigned int baseCounts[numBaseTypes]){
+	static const bool useAVX2 = hasAVX2();
+	if(useAVX2){
+		countBasesAVX2(seq, seqLen, baseCounts);
+	}else{
+		countBasesScalar(seq, seqLen, baseCounts);
+	}
+}
+
+/*** Count by table lookup, on any CPU
+**/
+void BaseComposition::countBasesScalar(const char* seq, size_t seqLen, unsigned int baseCounts[numBaseTypes]){
+	for(int base = 0; base < numBaseTypes; base++){
+		baseCounts[base] = 0;
+	}
+	const unsigned char* bases = (const unsigned char*)seq;
+	for(size_t i = 0; i < seqLen; i++){
+		baseCounts[baseTypeTable.baseTypes[bases[i]]]++;
+	}
+}
+
+#ifdef BASECOMPOSITION_X86
+
+/*** True if this build and CPU can run countBasesAVX2()
+**/
+bool BaseComposition::hasAVX2(){
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+}
+
+/*** Count 32 bases at a time by AVX2 compare and popcount.  Only call if hasAVX2()
+** Case bit cleared first, so each base is one compare; the tail is counted by table lookup.
+**/
+__attribute__((target("avx2,popcnt")))
+void BaseComposition::countBasesAVX2(const char* seq, size_t seqLen, unsigned int baseCounts[numBaseTypes]){
+	const __m256i caseMask = _mm256_set1_epi8((char)0xDF);
+	const __m256i aBytes = _mm256_set1_epi8('A');
+	const __m256i cBytes = _mm256_set1_epi8('C');
+	const __m256i gBytes = _mm256_set1_epi8('G');
+	const __m256i tBytes = _mm256_set1_epi8('T');
+	const __m256i nBytes = _mm256_set1_epi8('N');
+	unsigned int aCount = 0;
+	unsigned int cCount = 0;
+	unsigned int gCount = 0;
+	unsigned int tCount = 0;
+	unsigned int nCount = 0;
+
+	size_t i = 0;
+	for(; i + 32 <= seqLen; i += 32){
+		const __m256i upper = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(seq + i)), caseMask);
+		aCount += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(upper, aBytes)));
+		cCount += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(upper, cBytes)));
+		gCount += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(upper, gBytes)));
+		tCount += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(upper, tBytes)));
+		nCount += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(upper, nBytes)));
+	}
+
+	countBasesScalar(seq + i, seqLen - i, baseCounts);
+	baseCounts[baseA] += aCount;
+	baseCounts[baseC] += cCount;
+	baseCounts[baseG] += gCount;
+	baseCounts[baseT] += tCount;
+	baseCounts[baseN] += nCount;
+	baseCounts[baseOther] += i - (aCount + cCount + gCount + tCount + nCount);
+}
+
+#else
+
+bool BaseComposition::hasAVX2(){
+	return false;
+}
+
+void BaseComposition::countBasesAVX2(const char* seq, size_t seqLen, unsigned int baseCounts[numBaseTypes]){
+	countBasesScalar(seq, seqLen, baseCounts);
+}
+
+#endif
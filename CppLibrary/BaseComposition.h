@@ -0,0 +1,28 @@
+#ifndef BASECOMPOSITION_H
+#define BASECOMPOSITION_H
+
+#include <cstddef>
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/*** Counting of a sequence's bases (either case) as A/C/G/T/N/other, in one call per sequence.
+** Uses an AVX2 kernel where the CPU has it (checked once, at run time), else a table lookup per base.
+**/
+class BaseComposition {
+  public:
+	enum Base { baseA = 0, baseC, baseG, baseT, baseN, baseOther, numBaseTypes };
+
+		/*** Count a sequence's bases, by the fastest kernel this CPU supports **/
+	static void countBases(const char* seq, size_t seqLen, unsigned int baseCounts[numBaseTypes]);
+		/*** Count by table lookup, on any CPU **/
+	static void countBasesScalar(const char* seq, size_t seqLen, unsigned int baseCounts[numBaseTypes]);
+		/*** Count 32 bases at a time by AVX2 compare and popcount.  Only call if hasAVX2() **/
+	static void countBasesAVX2(const char* seq, size_t seqLen, unsigned int baseCounts[numBaseTypes]);
+		/*** True if this build and CPU can run countBasesAVX2() **/
+	static bool hasAVX2();
+};
+
+#endif
@@ -9,6 +9,8 @@
 #include <ctype.h>
 #include <sstream>
 #include <algorithm>
+#include <iterator>
+#include <zlib.h>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include "GeneCoverageTallyerSamGZ.h"
@@ -21,18 +23,18 @@ using namespace std;
 /*** Initialise with defaults 
 **/
 GeneCoverageTallyer::GeneCoverageTallyer(const vector<string>& aLabelsList, const vector<string>& aSAMFileNamesList, const string& aCoordFileName, const string& aOutTabFileName){
-	prepareCoverageTallyer(aLabelsList, aSAMFileNamesList, aCoordFileName, aOutTabFileName, 20, 0);
+	prepareCoverageTallyer(aLabelsList, aSAMFileNamesList, aCoordFileName, aOutTabFileName, 20, 0, 1, false, 1, "", false, "no", 0, false, false);
 	return;
 }
 
-GeneCoverageTallyer::GeneCoverageTallyer(const vector<string>& aLabelsList, const vector<string>& aSAMFileNamesList, const string& aCoordFileName, const string& aOutTabFileName, const int& aMinReads, const int& aUpDown){
-	prepareCoverageTallyer(aLabelsList, aSAMFileNamesList, aCoordFileName, aOutTabFileName, aMinReads, aUpDown);
+GeneCoverageTallyer::GeneCoverageTallyer(const vector<string>& aLabelsList, const vector<string>& aSAMFileNamesList, const string& aCoordFileName, const string& aOutTabFileName, const int& aMinReads, const int& aUpDown, const int& aThreadsPerSample, const bool& aDepthMode, const int& aBreadthDepth, const string& aCoordsFormat, const bool& aStrictOverlap, const string& aStrandMode, const int& aExcludeFlags, const bool& aFractionalNH, const bool& aTaggedLines){
+	prepareCoverageTallyer(aLabelsList, aSAMFileNamesList, aCoordFileName, aOutTabFileName, aMinReads, aUpDown, aThreadsPerSample, aDepthMode, aBreadthDepth, aCoordsFormat, aStrictOverlap, aStrandMode, aExcludeFlags, aFractionalNH, aTaggedLines);
 	return;
 }
 
 /*** Actual constructor 
 **/
-void GeneCoverageTallyer::prepareCoverageTallyer(const vector<string>& aLabelsList, const vector<string>& aSAMFileNamesList, const string& aCoordFileName, const string& aOutTabFileName, const int& aMinReads, const int& aUpDown){
+void GeneCoverageTallyer::prepareCoverageTallyer(const vector<string>& aLabelsList, const vector<string>& aSAMFileNamesList, const string& aCoordFileName, const string& aOutTabFileName, const int& aMinReads, const int& aUpDown, const int& aThreadsPerSample, const bool& aDepthMode, const int& aBreadthDepth, const string& aCoordsFormat, const bool& aStrictOverlap, const string& aStrandMode, const int& aExcludeFlags, const bool& aFractionalNH, const bool& aTaggedLines){
 
 	prepRan = false;
 	labels = aLabelsList;
@@ -40,7 +42,51 @@ void GeneCoverageTallyer::prepareCoverageTallyer(const vector<string>& aLabelsLi
 	inCoordFileName = aCoordFileName;
 	minReads = aMinReads;
 	updown = aUpDown;
+	threadsPerSample = max(1, aThreadsPerSample);
+	depthMode = aDepthMode;
+	breadthDepth = aBreadthDepth;
+	strictOverlap = aStrictOverlap;
+	strandMode = aStrandMode;
+	excludeFlags = aExcludeFlags;
+	fractionalNH = aFractionalNH;
+	taggedLines = aTaggedLines || aFractionalNH;
+	if(strandMode == "no"){
+		strandCounting = strandEither;
+	}else if(strandMode == "yes"){
+		strandCounting = strandSame;
+	}else if(strandMode == "reverse"){
+		strandCounting = strandReverse;
+	}else{
+		cerr << "Unknown strand mode " << strandMode << "!\nNo read tallying will follow.\n";
+		return;
+	}
+	
+	// Coords format from file extension if not given
+	coordsFormat = aCoordsFormat;
+	if(coordsFormat == ""){
+		coordsFormat = "tab";
+		const size_t dotPos = inCoordFileName.find_last_of('.');
+		if(dotPos != string::npos){
+			string ext = inCoordFileName.substr(dotPos + 1);
+			transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+			if(ext == "gtf"){
+				coordsFormat = "gtf";
+			}else if(ext == "gff" || ext == "gff3"){
+				coordsFormat = "gff3";
+			}else if(ext == "bed"){
+				coordsFormat = "bed";
+			}
+		}
+	}
+	if(coordsFormat != "tab" && coordsFormat != "gtf" && coordsFormat != "gff3" && coordsFormat != "bed"){
+		cerr << "Unknown coords file format " << coordsFormat << "!\nNo read tallying will follow.\n";
+		return;
+	}
+	exonAware = (coordsFormat != "tab");
+	recordBlocks = (depthMode || exonAware);
 	numSamples = labels.size();
+	numGenes = 0;
+	sampleTallies.assign(numSamples, SampleTally());
 	
 	outtabfile.open(aOutTabFileName.c_str());
 	if(!outtabfile.is_open()){
@@ -72,7 +118,16 @@ bool GeneCoverageTallyer::tallyCoverage(){
 		return false;
 	}else{
 		
-		#pragma omp parallel for
+		// Share threads between samples, leaving threadsPerSample workers for each
+		int sampleThreads = 1;
+		if(threadsPerSample > 1){
+			omp_set_max_active_levels(2);
+			sampleThreads = max(1, omp_get_max_threads() / threadsPerSample);
+		}else{
+			sampleThreads = omp_get_max_threads();
+		}
+
+		#pragma omp parallel for num_threads(sampleThreads)
 		for(int sNum=0; sNum < numSamples; sNum++){	
 			if(!tallyReadsForSample(sNum)){
 				cerr << "Failed to parse reads for " << labels[sNum] << " from " << inSAMFileNames[sNum] << endl;
@@ -88,11 +143,10 @@ bool GeneCoverageTallyer::tallyCoverage(){
 
 
 /*** Read gene coords list to form list of test coordinates
-** Also initialises read count tables
+** Also numbers refSeqs and genes for the per-sample read count tables
 **/
 bool GeneCoverageTallyer::loadCoordsList(){
 	ifstream infile;
-	string line;
 	infile.open(inCoordFileName.c_str());
 	if (!infile.is_open()){
 		cerr << "Unable to open coords file " << inCoordFileName << "!\n";
@@ -103,10 +157,92 @@ bool GeneCoverageTallyer::loadCoordsList(){
 		return false;
 	}
 	
-	cout << "Parsing coords list from " << inCoordFileName << endl;
-
-	maxGene = 0;
+	cout << "Parsing " << coordsFormat << " coords list from " << inCoordFileName << endl;
+	if(coordsFormat == "gtf" || coordsFormat == "gff3"){
+		loadGTFCoords(infile, coordsFormat == "gff3");
+	}else if(coordsFormat == "bed"){
+		loadBEDCoords(infile);
+	}else{
+		loadTabCoords(infile);
+	}
+	infile.close();
+	
+	int numRefIDs = geneCoords.size();
+	unsigned int numCoords = 0;
+	geneIndexes.assign(numRefIDs, IntervalIndex());
+	if(exonAware){
+		refExons.assign(numRefIDs, vector< ExonSpan >());
+		exonIndexes.assign(numRefIDs, IntervalIndex());
+	}
+	for (CoordMap::iterator aRef=geneCoords.begin(); aRef!=geneCoords.end(); ++aRef){
+		sort(aRef->second.begin(), aRef->second.end());
+		
+		// Number refSeqs, and genes across all refSeqs
+		const int refIdx = refIndexes.size();
+		refIndexes[aRef->first] = refIdx;
+		geneOffsets.push_back(numCoords);
+		numCoords += aRef->second.size();
+		for(int geneI = 0; geneI < aRef->second.size(); geneI++){
+			geneStrands.push_back(aRef->second[geneI].strand);
+		}
+		
+		// Index genes, as half-open intervals widened by up/down-stream extra
+		IntervalIndex& refIndex = geneIndexes[refIdx];
+		for(int geneI = 0; geneI < aRef->second.size(); geneI++){
+			const GeneCoord& gene = aRef->second[geneI];
+			unsigned int indexStart = 0;
+			if(gene.start > updown){
+				indexStart = gene.start - updown;
+			}
+			refIndex.add(indexStart, gene.end + updown, geneI);
+		}
+		refIndex.index();
+		
+		// Index all genes' exons, widening first and last by up/down-stream extra
+		if(exonAware){
+			for(int geneI = 0; geneI < aRef->second.size(); geneI++){
+				const vector< pair< unsigned int, unsigned int > >& exons = aRef->second[geneI].exons;
+				for(int exonI = 0; exonI < exons.size(); exonI++){
+					unsigned int exonStart = exons[exonI].first;
+					unsigned int exonEnd = exons[exonI].second;
+					if(exonI == 0){
+						exonStart = (exonStart > updown) ? exonStart - updown : 0;
+					}
+					if(exonI == exons.size() - 1){
+						exonEnd += updown;
+					}
+					exonIndexes[refIdx].add(exonStart, exonEnd, refExons[refIdx].size());
+					refExons[refIdx].push_back(ExonSpan(exonStart, exonEnd, geneI));
+				}
+			}
+			exonIndexes[refIdx].index();
+		}
+		
+		if(depthMode){
+			buildDepthSegments(refIdx, aRef->second);
+		}
+	}
+	numGenes = numCoords;
+	cout << "Loaded " << numCoords << " test coords over " << numRefIDs << " reference sequences." << endl;
+	if(depthMode){
+		unsigned long long depthBases = 0;
+		for(int refIdx=0; refIdx < depthSegments.size(); refIdx++){
+			depthBases += depthLens[refIdx] - depthSegments[refIdx].size();
+		}
+		cout << "Tallying depth over " << depthBases << " bases of merged gene spans." << endl;
+	}
 	
+	if(numCoords == 0){
+		return false;
+	}
+	return true;
+}
+
+/*** Read a tab-separated coords list of refID, start, end, gene name, [additional columns]
+** Genes count reads overlapping anywhere in their span
+**/
+void GeneCoverageTallyer::loadTabCoords(ifstream& infile){
+	string line;
 	while(getline(infile, line)){
 		stringstream linestream(line);
 		vector<string> lineParts;
@@ -117,7 +253,7 @@ bool GeneCoverageTallyer::loadCoordsList(){
 			lineParts.push_back(aLinePart);
 		}
 		
-		//refID \t start \t end \t more
+		//refID \t start \t end \t name \t [strand] \t more
 		if(lineParts.size() >= 4){
 			string refID = lineParts[0];
 			string geneName = lineParts[3];
@@ -135,88 +271,545 @@ bool GeneCoverageTallyer::loadCoordsList(){
 
 			if(geneCoords.count(refID) == 0){
 				geneCoords[refID] = vector< GeneCoord >();
-				readCounts[refID] = vector< vector< unsigned int > >();
 			}
 			
 			geneCoords[refID].push_back( GeneCoord(start, end, geneName) );
-			readCounts[refID].push_back( vector< unsigned int >(numSamples, 0) );
+			if(lineParts.size() >= 5 && (lineParts[4] == "+" || lineParts[4] == "-")){
+				geneCoords[refID].back().strand = lineParts[4][0];
+			}
+		}
+	}
+	return;
+}
+
+
+/*** Read exons from a GTF or GFF3 annotation, grouped by gene
+** GTF exons are grouped by gene_id.  GFF3 exons are grouped by the top of their chain of Parent features, 
+** usually exon -> mRNA/transcript -> gene.  Coords are converted from 1-based inclusive to 0-based half-open.
+**/
+void GeneCoverageTallyer::loadGTFCoords(ifstream& infile, const bool isGFF3){
+	string line;
+	ExonMap geneExons;
+	map< string, string > parentIDs; //!< GFF3 feature ID, its first Parent ID
+	vector< string > exonRefIDs;
+	vector< string > exonParents;
+	vector< pair< unsigned int, unsigned int > > exonCoords;
+	vector< char > exonStrands;
 
-			if(end - start + 1 > maxGene){
-				maxGene = end - start + 1;
+	while(getline(infile, line)){
+		if(line.empty() || line[0] == '#'){
+			if(isGFF3 && line.compare(0, 7, "##FASTA") == 0){
+				break;
 			}
+			continue;
+		}
+		stringstream linestream(line);
+		vector<string> lineParts;
+		lineParts.reserve(9);
+		string aLinePart;
+		// Tab separated split
+		while(getline(linestream, aLinePart, '\t')){
+			lineParts.push_back(aLinePart);
+		}
+		//refID \t source \t feature \t start \t end \t score \t strand \t frame \t attributes
+		if(lineParts.size() < 9){
+			continue;
+		}
+		
+		// Split attributes, GTF as key "value"; and GFF3 as key=value;
+		map< string, string > attributes;
+		stringstream attribstream(lineParts[8]);
+		string attrib;
+		while(getline(attribstream, attrib, ';')){
+			const size_t keyStart = attrib.find_first_not_of(' ');
+			if(keyStart == string::npos){
+				continue;
+			}
+			const size_t keyEnd = attrib.find_first_of(isGFF3 ? "=" : " ", keyStart);
+			if(keyEnd == string::npos){
+				continue;
+			}
+			string value = attrib.substr(keyEnd + 1);
+			if(!isGFF3){
+				const size_t valStart = value.find_first_not_of(" \"");
+				const size_t valEnd = value.find_last_not_of(" \"");
+				value = (valStart == string::npos) ? "" : value.substr(valStart, valEnd - valStart + 1);
+			}
+			attributes[attrib.substr(keyStart, keyEnd - keyStart)] = value;
+		}
+
+		if(isGFF3 && attributes.count("ID") && attributes.count("Parent")){
+			parentIDs[attributes["ID"]] = attributes["Parent"].substr(0, attributes["Parent"].find(','));
+		}
+		if(lineParts[2] != "exon"){
+			continue;
+		}
+		
+		unsigned int start = atoi(lineParts[3].c_str());
+		unsigned int end = atoi(lineParts[4].c_str());
+		if(end < start){
+			unsigned int temp = start;
+			start = end;
+			end = temp;
+		}
+		if(start > 0){
+			start = start - 1;
+		}
+
+		if(isGFF3){
+			// An exon can belong to multiple transcripts. Gene resolved once all Parent features are known.
+			stringstream parentstream(attributes["Parent"]);
+			string parentID;
+			while(getline(parentstream, parentID, ',')){
+				exonRefIDs.push_back(lineParts[0]);
+				exonParents.push_back(parentID);
+				exonCoords.push_back(make_pair(start, end));
+				exonStrands.push_back(lineParts[6][0]);
+			}
+		}else if(attributes.count("gene_id")){
+			AnnotatedGene& gene = geneExons[lineParts[0]][attributes["gene_id"]];
+			gene.exons.push_back(make_pair(start, end));
+			gene.strand = lineParts[6][0];
 		}
 	}
-	infile.close();
-	
-	int numRefIDs = geneCoords.size();
-	unsigned int numCoords = 0;
-	for (CoordMap::iterator aRef=geneCoords.begin(); aRef!=geneCoords.end(); ++aRef){
-		sort(aRef->second.begin(), aRef->second.end());
-		numCoords += aRef->second.size();
+
+	for(int exonI = 0; exonI < exonParents.size(); exonI++){
+		string geneID = exonParents[exonI];
+		map< string, string >::const_iterator aParent = parentIDs.find(geneID);
+		for(int depth = 0; aParent != parentIDs.end() && depth < 100; depth++){
+			geneID = aParent->second;
+			aParent = parentIDs.find(geneID);
+		}
+		if(geneID != ""){
+			AnnotatedGene& gene = geneExons[exonRefIDs[exonI]][geneID];
+			gene.exons.push_back(exonCoords[exonI]);
+			gene.strand = exonStrands[exonI];
+		}
 	}
-	cout << "Loaded " << numCoords << " test coords over " << numRefIDs << " reference sequences." << endl;
-	
-	if(numCoords == 0){
-		return false;
+	addAnnotationGenes(geneExons);
+	return;
+}
+
+
+/*** Read blocks from a BED annotation, grouped by name
+** BED12 lines give a transcript with its blocks as exons, fewer columns give a single exon.
+**/
+void GeneCoverageTallyer::loadBEDCoords(ifstream& infile){
+	string line;
+	ExonMap geneExons;
+
+	while(getline(infile, line)){
+		if(line.empty() || line[0] == '#' || line.compare(0, 5, "track") == 0 || line.compare(0, 7, "browser") == 0){
+			continue;
+		}
+		stringstream linestream(line);
+		vector<string> lineParts;
+		lineParts.reserve(12);
+		string aLinePart;
+		// Tab separated split
+		while(getline(linestream, aLinePart, '\t')){
+			lineParts.push_back(aLinePart);
+		}
+		//refID \t start \t end \t name \t score \t strand \t thickStart \t thickEnd \t rgb \t blockCount \t blockSizes \t blockStarts
+		if(lineParts.size() < 4){
+			continue;
+		}
+		const unsigned int start = atoi(lineParts[1].c_str());
+		const unsigned int end = atoi(lineParts[2].c_str());
+		AnnotatedGene& gene = geneExons[lineParts[0]][lineParts[3]];
+		vector< pair< unsigned int, unsigned int > >& exons = gene.exons;
+		if(lineParts.size() >= 6 && !lineParts[5].empty()){
+			gene.strand = lineParts[5][0];
+		}
+
+		if(lineParts.size() >= 12){
+			const int blockCount = atoi(lineParts[9].c_str());
+			stringstream sizestream(lineParts[10]);
+			stringstream startstream(lineParts[11]);
+			string blockSize;
+			string blockStart;
+			for(int blockI = 0; blockI < blockCount; blockI++){
+				if(!getline(sizestream, blockSize, ',') || !getline(startstream, blockStart, ',')){
+					break;
+				}
+				const unsigned int exonStart = start + atoi(blockStart.c_str());
+				exons.push_back(make_pair(exonStart, exonStart + atoi(blockSize.c_str())));
+			}
+		}else if(end > start){
+			exons.push_back(make_pair(start, end));
+		}
 	}
-	return true;
+	addAnnotationGenes(geneExons);
+	return;
 }
 
+
+/*** Merge each gene's exons, from all its transcripts, and add genes to geneCoords spanning first to last exon
+**/
+void GeneCoverageTallyer::addAnnotationGenes(ExonMap& geneExons){
+
+	for(ExonMap::iterator aRef = geneExons.begin(); aRef != geneExons.end(); ++aRef){
+		for(map< string, AnnotatedGene >::iterator aGene = aRef->second.begin(); aGene != aRef->second.end(); ++aGene){
+			vector< pair< unsigned int, unsigned int > >& exons = aGene->second.exons;
+			if(exons.empty()){
+				continue;
+			}
+			sort(exons.begin(), exons.end());
+			int numMerged = 0;
+			for(int exonI = 1; exonI < exons.size(); exonI++){
+				if(exons[exonI].first <= exons[numMerged].second){
+					exons[numMerged].second = max(exons[numMerged].second, exons[exonI].second);
+				}else{
+					numMerged++;
+					exons[numMerged] = exons[exonI];
+				}
+			}
+			exons.resize(numMerged + 1);
+
+			geneCoords[aRef->first].push_back( GeneCoord(exons.front().first, exons.back().second, aGene->first) );
+			geneCoords[aRef->first].back().exons = exons;
+			if(aGene->second.strand == '+' || aGene->second.strand == '-'){
+				geneCoords[aRef->first].back().strand = aGene->second.strand;
+			}
+		}
+	}
+	return;
+}
+
+
 /*** Read the sam.gz file to tally reads for a specific sample
+** With more than one thread per sample, each worker tallies into its own counts, summed at the end
 **/
 bool GeneCoverageTallyer::tallyReadsForSample(const int sNum){
 
-	ifstream fileifs(inSAMFileNames[sNum].c_str(), ios_base::in | ios_base::binary);
-	try {
-		boost::iostreams::filtering_istream infile;
-		infile.push(boost::iostreams::gzip_decompressor());
-		infile.push(fileifs);
-		cout << "Parsing reads from " << inSAMFileNames[sNum] << endl;
-		unsigned int sampTotReads = 0;
-		string line;
-		while(getline(infile, line)){
-			unsigned int rStart = 0;
-			unsigned int rEnd = 0;
-			string rRefID;
-			if(getReadCoordFromSamLine(line, rStart, rEnd, rRefID)){
-				sampTotReads++;
-				addReadTally(rStart, rEnd, rRefID, sNum);
-			}
-		}
-		cout << "Loaded " << sampTotReads << " reads from " << inSAMFileNames[sNum] << endl;
-	}
-	catch(const boost::iostreams::gzip_error& e) {
-		cerr << "Error while reading sam.gz file " << inSAMFileNames[sNum] << endl;
-		cerr << e.what() << endl;
+	SampleTally& tally = sampleTallies[sNum];
+	tally.init(numGenes, depthSegments.size());
+	cout << "Parsing reads from " << inSAMFileNames[sNum] << endl;
+
+	bool success = true;
+	if(threadsPerSample == 1){
+		ifstream fileifs(inSAMFileNames[sNum].c_str(), ios_base::in | ios_base::binary);
+		try {
+			boost::iostreams::filtering_istream infile;
+			infile.push(boost::iostreams::gzip_decompressor());
+			infile.push(fileifs);
+			string line;
+			while(getline(infile, line)){
+				tallySamLine(line, tally);
+			}
+		}
+		catch(const boost::iostreams::gzip_error& e) {
+			cerr << "Error while reading sam.gz file " << inSAMFileNames[sNum] << endl;
+			cerr << e.what() << endl;
+			return false;
+		}
+	}else{
+		vector< SampleTally > workerTallies(threadsPerSample);
+		for(int w=0; w < threadsPerSample; w++){
+			workerTallies[w].init(numGenes, depthSegments.size());
+		}
+		vector< unsigned long long > blockOffsets;
+		if(getBGZFBlocks(inSAMFileNames[sNum], blockOffsets)){
+			success = tallyReadsBGZF(sNum, blockOffsets, workerTallies);
+		}else{
+			success = tallyReadsStreamed(sNum, workerTallies);
+		}
+		for(int w=0; w < threadsPerSample; w++){
+			tally.add(workerTallies[w]);
+		}
+	}
+	if(success){
+		cout << "Loaded " << tally.totReads << " reads from " << inSAMFileNames[sNum] << endl;
+		if(depthMode){
+			summariseDepth(tally);
+		}
+	}
+	return success;
+}
+
+
+/*** Tally reads for a sample from a plain gzip file
+** Decompression can't be split, so one thread reads batches of lines and hands each batch to a worker task
+**/
+bool GeneCoverageTallyer::tallyReadsStreamed(const int sNum, vector< SampleTally >& workerTallies){
+
+	bool success = true;
+	#pragma omp parallel num_threads(threadsPerSample)
+	{
+		#pragma omp single
+		{
+			ifstream fileifs(inSAMFileNames[sNum].c_str(), ios_base::in | ios_base::binary);
+			try {
+				boost::iostreams::filtering_istream infile;
+				infile.push(boost::iostreams::gzip_decompressor());
+				infile.push(fileifs);
+				bool moreLines = true;
+				while(moreLines){
+					vector< string >* batch = new vector< string >(lineBatchSize);
+					int numLines = 0;
+					while(numLines < lineBatchSize && getline(infile, (*batch)[numLines])){
+						numLines++;
+					}
+					moreLines = (numLines == lineBatchSize);
+					
+					#pragma omp task firstprivate(batch, numLines)
+					{
+						SampleTally& tally = workerTallies[omp_get_thread_num()];
+						for(int i=0; i < numLines; i++){
+							tallySamLine((*batch)[i], tally);
+						}
+						delete batch;
+					}
+				}
+			}
+			catch(const boost::iostreams::gzip_error& e) {
+				cerr << "Error while reading sam.gz file " << inSAMFileNames[sNum] << endl;
+				cerr << e.what() << endl;
+				success = false;
+			}
+			#pragma omp taskwait
+		}
+	}
+	return success;
+}
+
+
+/*** Tally reads for a sample from a BGZF file
+** Blocks are split into an even range per worker.  Each worker tallies the lines starting within its range.
+**/
+bool GeneCoverageTallyer::tallyReadsBGZF(const int sNum, const vector< unsigned long long >& blockOffsets, vector< SampleTally >& workerTallies){
+
+	const int numBlocks = blockOffsets.size() - 1;
+	bool success = true;
+	#pragma omp parallel for num_threads(threadsPerSample) schedule(static, 1)
+	for(int w=0; w < threadsPerSample; w++){
+		const int firstBlock = (long long)numBlocks * w / threadsPerSample;
+		const int endBlock = (long long)numBlocks * (w + 1) / threadsPerSample;
+		if(!tallyBGZFRange(inSAMFileNames[sNum], blockOffsets, firstBlock, endBlock, workerTallies[w])){
+			#pragma omp critical
+			success = false;
+		}
+	}
+	if(!success){
+		cerr << "Error while reading BGZF sam.gz file " << inSAMFileNames[sNum] << endl;
+	}
+	return success;
+}
+
+
+/*** Tally the reads in one worker's range of BGZF blocks
+** A line belongs to the range its first character is in: skip a partial line at range start,
+** and read on past range end to finish the last line.
+**/
+bool GeneCoverageTallyer::tallyBGZFRange(const string& inFileName, const vector< unsigned long long >& blockOffsets, const int firstBlock, const int endBlock, SampleTally& tally){
+
+	if(firstBlock >= endBlock){
+		return true;
+	}
+	ifstream infile(inFileName.c_str(), ios_base::in | ios_base::binary);
+	if(!infile.is_open()){
+		return false;
+	}
+	const int numBlocks = blockOffsets.size() - 1;
+	string compressed;
+	string data;
+	string line;
+
+	// Check whether range starts part way through a line
+	bool skipping = false;
+	for(int b = firstBlock - 1; b >= 0; b--){
+		if(!inflateBGZFBlock(infile, blockOffsets, b, compressed, data)){
+			return false;
+		}
+		if(!data.empty()){
+			skipping = (data[data.size() - 1] != '\n');
+			break;
+		}
+	}
+
+	line.clear();
+	for(int b = firstBlock; b < numBlocks; b++){
+		if(b >= endBlock && line.empty() ){
+			break;
+		}
+		if(!inflateBGZFBlock(infile, blockOffsets, b, compressed, data)){
+			return false;
+		}
+		size_t pos = 0;
+		if(skipping){
+			pos = data.find('\n');
+			if(pos == string::npos){
+				continue;
+			}
+			pos++;
+			skipping = false;
+		}
+		size_t lineEnd;
+		while((lineEnd = data.find('\n', pos)) != string::npos){
+			line.append(data, pos, lineEnd - pos);
+			tallySamLine(line, tally);
+			line.clear();
+			pos = lineEnd + 1;
+			if(b >= endBlock){
+				return true;
+			}
+		}
+		line.append(data, pos, string::npos);
+	}
+	if(!line.empty()){
+		tallySamLine(line, tally);
+	}
+	return true;
+}
+
+
+/*** List the file offset of every block if a file is BGZF, with file size at end
+** Returns false for plain gzip, or anything else not read as BGZF
+**/
+bool GeneCoverageTallyer::getBGZFBlocks(const string& inFileName, vector< unsigned long long >& blockOffsets){
+
+	ifstream infile(inFileName.c_str(), ios_base::in | ios_base::binary);
+	if(!infile.is_open()){
+		return false;
+	}
+	blockOffsets.clear();
+	unsigned long long offset = 0;
+	unsigned char header[18];
+	while(infile.read((char*)header, 18)){
+		// gzip magic, deflate, FEXTRA flag, 6 byte extra field holding 'BC' subfield with block size
+		if(header[0] != 31 || header[1] != 139 || header[2] != 8 || (header[3] & 4) == 0 ||
+				header[10] != 6 || header[11] != 0 || header[12] != 'B' || header[13] != 'C' ||
+				header[14] != 2 || header[15] != 0){
+			return false;
+		}
+		blockOffsets.push_back(offset);
+		offset += (header[16] | (header[17] << 8)) + 1;
+		infile.seekg(offset);
+	}
+	if(!infile.eof() || infile.gcount() != 0 || blockOffsets.empty()){
 		return false;
 	}
+	blockOffsets.push_back(offset);
 	return true;
 }
 
 
+/*** Decompress one BGZF block, each being a complete gzip member
+**/
+bool GeneCoverageTallyer::inflateBGZFBlock(ifstream& infile, const vector< unsigned long long >& blockOffsets, const int blockNum, string& compressed, string& data){
+
+	const unsigned int blockSize = blockOffsets[blockNum + 1] - blockOffsets[blockNum];
+	compressed.resize(blockSize);
+	infile.clear();
+	infile.seekg(blockOffsets[blockNum]);
+	if(!infile.read(&compressed[0], blockSize)){
+		return false;
+	}
+	// Uncompressed size is the last 4 bytes of the block
+	const unsigned char* isize = (const unsigned char*)&compressed[blockSize - 4];
+	const unsigned int dataSize = isize[0] | (isize[1] << 8) | (isize[2] << 16) | ((unsigned int)isize[3] << 24);
+	data.resize(dataSize);
+	if(dataSize == 0){
+		return true;
+	}
+
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if(inflateInit2(&zs, 15 + 16) != Z_OK){
+		return false;
+	}
+	zs.next_in = (Bytef*)&compressed[0];
+	zs.avail_in = blockSize;
+	zs.next_out = (Bytef*)&data[0];
+	zs.avail_out = dataSize;
+	const int status = inflate(&zs, Z_FINISH);
+	inflateEnd(&zs);
+	return (status == Z_STREAM_END && zs.avail_out == 0);
+}
+
+
+/*** Tally a single line of SAM
+**/
+void GeneCoverageTallyer::tallySamLine(const string& line, SampleTally& tally){
+	unsigned int rStart = 0;
+	unsigned int rEnd = 0;
+	int rRefIdx;
+	char rStrand;
+	int rNumHits = 1;
+	if(getReadCoordFromSamLine(line, rStart, rEnd, rRefIdx, rStrand, rNumHits, tally)){
+		tally.totReads++;
+		double weight = 1;
+		if(fractionalNH && rNumHits > 1){
+			weight = 1.0 / rNumHits;
+		}
+		if(exonAware){
+			addReadExonTally(rRefIdx, rStrand, weight, tally);
+		}else{
+			addReadTally(rStart, rEnd, rRefIdx, rStrand, weight, tally);
+		}
+		if(depthMode){
+			addReadDepth(rRefIdx, tally);
+		}
+	}
+	return;
+}
+
+
 /*** Test if a line is SAM format aligned read then extract read coordinates
 **/
-bool GeneCoverageTallyer::getReadCoordFromSamLine(const string& line, unsigned int& rStart, unsigned int& rEnd, string& rRefID ){
+bool GeneCoverageTallyer::getReadCoordFromSamLine(const string& line, unsigned int& rStart, unsigned int& rEnd, int& rRefIdx, char& rStrand, int& rNumHits, SampleTally& tally){
 
+	if(line.empty() || line[0] == '@'){
+		return false;
+	}
 	stringstream linestream(line);
 	vector<string> lineParts;
-	lineParts.reserve(11);
+	lineParts.reserve(12);
 	string aLinePart;
 	// Tab separated split
 	while(getline(linestream, aLinePart, '\t')){
 		lineParts.push_back(aLinePart);
 	}
-	if(lineParts.size() == 11){
-		// readID == [0], refID == [2], start == [3], cigar == [5], readSeq == [9]
+	if(lineParts.size() == 11 || (taggedLines && lineParts.size() > 11)){
+		// readID == [0], flag == [1], refID == [2], start == [3], cigar == [5], readSeq == [9], optional tags from [11]
+
+		const int flag = atoi(lineParts[1].c_str());
+		if((flag & 4) || (flag & excludeFlags)){
+			return false;
+		}
+		// Strand of the fragment: read 2 of a pair is flipped to match read 1
+		bool reverse = (flag & 16);
+		if((flag & 1) && (flag & 128)){
+			reverse = !reverse;
+		}
+		rStrand = reverse ? '-' : '+';
+		rNumHits = 1;
+		if(fractionalNH){
+			for(int tagI = 11; tagI < lineParts.size(); tagI++){
+				if(lineParts[tagI].compare(0, 5, "NH:i:") == 0){
+					rNumHits = atoi(lineParts[tagI].c_str() + 5);
+					break;
+				}
+			}
+		}
 
 		// If there are genes to tally for refSeq aligned to
-		if(geneCoords.count(lineParts[2])){
-			rRefID = lineParts[2];
+		if(lineParts[2] != tally.lastRefID){
+			map< string, int >::const_iterator aRef = refIndexes.find(lineParts[2]);
+			tally.lastRefID = lineParts[2];
+			tally.lastRefIdx = (aRef == refIndexes.end()) ? -1 : aRef->second;
+		}
+		rRefIdx = tally.lastRefIdx;
+		if(rRefIdx >= 0){
 
 			stringstream startstream(lineParts[3]);
 			startstream >> rStart;
 			rStart = rStart - 1;
 			rEnd = rStart;
+			unsigned int blockStart = rStart;
+			if(recordBlocks){
+				tally.alignedBlocks.clear();
+			}
 
 			// Process cigar string
 			int valStartI = 0;
@@ -240,7 +833,11 @@ bool GeneCoverageTallyer::getReadCoordFromSamLine(const string& line, unsigned i
 							break;
 							
 						case('N'): // Intron
+							if(recordBlocks && rEnd > blockStart){
+								tally.alignedBlocks.push_back(make_pair(blockStart, rEnd));
+							}
 							rEnd += value;
+							blockStart = rEnd;
 							break;
 							
 						case('D'):  // Del
@@ -254,47 +851,279 @@ bool GeneCoverageTallyer::getReadCoordFromSamLine(const string& line, unsigned i
 				}
 			}
 
+			if(recordBlocks && rEnd > blockStart){
+				tally.alignedBlocks.push_back(make_pair(blockStart, rEnd));
+			}
 			if(rEnd > rStart){
 				return true;
 			}
-		}else{
-			return false;
 		}
-	}else{
-		return false;
 	}
+	return false;
 }
 
 
 /*** Test if a read overlaps a gene or genes, add it to the tally 
 **/
-void GeneCoverageTallyer::addReadTally(const unsigned int& rStart, const unsigned int& rEnd, const string& rRefID, const int sNum){
-
-	// Binary search to first potentially overlapping gene
-	int lowBound = 0;
-	int highBound = geneCoords[rRefID].size();
-	while(lowBound != highBound){
-		int midpoint = (lowBound + highBound) / 2;
-		if( geneCoords[rRefID][midpoint].start + maxGene + updown <= rStart ){
-			lowBound = midpoint + 1;
+void GeneCoverageTallyer::addReadTally(const unsigned int& rStart, const unsigned int& rEnd, const int rRefIdx, const char rStrand, const double weight, SampleTally& tally){
+
+	// Genes overlapping read, including up/down-stream buffer, counted as found
+	const unsigned int geneOffset = geneOffsets[rRefIdx];
+	GeneHitCounter counter;
+	counter.refCounts = &tally.geneCounts[geneOffset];
+	counter.refStrands = NULL;
+	counter.wantStrand = rStrand;
+	counter.weight = weight;
+	if(strandCounting != strandEither){
+		counter.refStrands = &geneStrands[geneOffset];
+		if(strandCounting == strandReverse){
+			counter.wantStrand = (rStrand == '+') ? '-' : '+';
+		}
+	}
+	geneIndexes[rRefIdx].visitOverlaps(rStart, rEnd, counter);
+	return;
+}
+
+
+/*** Add a read to the tally of each gene in geneHits for sample
+** With strand-specific counting, genes of known strand only count reads from the matching (or reverse) strand
+**/
+void GeneCoverageTallyer::countGeneHits(const int rRefIdx, const char rStrand, const double weight, SampleTally& tally){
+
+	const unsigned int geneOffset = geneOffsets[rRefIdx];
+	double* refCounts = &tally.geneCounts[geneOffset];
+	if(strandCounting == strandEither){
+		for(int i=0; i < tally.geneHits.size(); i++){
+			refCounts[tally.geneHits[i]] += weight;
+		}
+	}else{
+		const char otherStrand = (rStrand == '+') ? '-' : '+';
+		const char wantStrand = (strandCounting == strandSame) ? rStrand : otherStrand;
+		for(int i=0; i < tally.geneHits.size(); i++){
+			const char geneStrand = geneStrands[geneOffset + tally.geneHits[i]];
+			if(geneStrand == wantStrand || geneStrand == '.'){
+				refCounts[tally.geneHits[i]] += weight;
+			}
+		}
+	}
+	return;
+}
+
+
+/*** Test which genes a read's aligned blocks hit exons of, add it to the tally
+** Union: a gene is hit if any block overlaps one of its exons.
+** Strict: a gene is hit only if every block lies within one of its (merged) exons.
+**/
+void GeneCoverageTallyer::addReadExonTally(const int rRefIdx, const char rStrand, const double weight, SampleTally& tally){
+
+	BlockGeneGatherer gatherer;
+	gatherer.exons = &refExons[rRefIdx];
+	gatherer.strictOverlap = strictOverlap;
+	gatherer.blockGenes = &tally.blockGenes;
+	tally.geneHits.clear();
+	for(int blockI=0; blockI < tally.alignedBlocks.size(); blockI++){
+		gatherer.bStart = tally.alignedBlocks[blockI].first;
+		gatherer.bEnd = tally.alignedBlocks[blockI].second;
+		
+		tally.blockGenes.clear();
+		exonIndexes[rRefIdx].visitOverlaps(gatherer.bStart, gatherer.bEnd, gatherer);
+
+		if(strictOverlap){
+			sort(tally.blockGenes.begin(), tally.blockGenes.end());
+			if(blockI == 0){
+				tally.geneHits.swap(tally.blockGenes);
+			}else{
+				// Keep genes hit by all blocks so far
+				tally.exonHits.clear();
+				set_intersection(tally.geneHits.begin(), tally.geneHits.end(), tally.blockGenes.begin(), tally.blockGenes.end(), back_inserter(tally.exonHits));
+				tally.geneHits.swap(tally.exonHits);
+			}
+			if(tally.geneHits.empty()){
+				return;
+			}
 		}else{
-			highBound = midpoint;
+			tally.geneHits.insert(tally.geneHits.end(), tally.blockGenes.begin(), tally.blockGenes.end());
 		}
 	}
-	for(int i=lowBound; i < geneCoords[rRefID].size(); i++ ){
+	sort(tally.geneHits.begin(), tally.geneHits.end());
+	tally.geneHits.erase(unique(tally.geneHits.begin(), tally.geneHits.end()), tally.geneHits.end());
 
-		// If gene and read overlap, including up/down-stream buffer
-		if( (rStart + updown >= geneCoords[rRefID][i].start && rStart < geneCoords[rRefID][i].end + updown) || 
-				(rEnd + updown > geneCoords[rRefID][i].start && rEnd <= geneCoords[rRefID][i].end + updown) || 
-				(rStart + updown < geneCoords[rRefID][i].start && rEnd > geneCoords[rRefID][i].end + updown) ){
+	countGeneHits(rRefIdx, rStrand, weight, tally);
+	return;
+}
 
-			// Add read to gene tally for sample
-			readCounts[rRefID][i][sNum] += 1;
+
+/*** Add a read's aligned blocks to the depth tally
+** Deletions count as covered, introns don't.  Only the parts within gene spans are kept,
+** as a +1 at block start and -1 at block end, summed into per-base depth at output.
+**/
+void GeneCoverageTallyer::addReadDepth(const int rRefIdx, SampleTally& tally){
+
+	const vector< DepthSegment >& segments = depthSegments[rRefIdx];
+	vector< int >& depthDiffs = tally.depthDiffs[rRefIdx];
+	if(depthDiffs.empty()){
+		depthDiffs.assign(depthLens[rRefIdx], 0);
+	}
+	for(int blockI=0; blockI < tally.alignedBlocks.size(); blockI++){
+		const unsigned int bStart = tally.alignedBlocks[blockI].first;
+		const unsigned int bEnd = tally.alignedBlocks[blockI].second;
+
+		// First segment ending after block start
+		int lo = 0;
+		int hi = segments.size();
+		while(lo < hi){
+			const int mid = (lo + hi) / 2;
+			if(segments[mid].end <= bStart){
+				lo = mid + 1;
+			}else{
+				hi = mid;
+			}
+		}
+		for(int segI = lo; segI < segments.size() && segments[segI].start < bEnd; segI++){
+			const DepthSegment& seg = segments[segI];
+			const unsigned int clipStart = max(bStart, seg.start);
+			const unsigned int clipEnd = min(bEnd, seg.end);
+			depthDiffs[seg.offset + (clipStart - seg.start)] += 1;
+			depthDiffs[seg.offset + (clipEnd - seg.start)] -= 1;
 		}
+	}
+	return;
+}
 
-		if(geneCoords[rRefID][i].start > rEnd + updown){
-			break;
+
+/*** Merge a refSeq's overlapping gene spans (including up/down-stream extra) into depth segments
+** Each segment takes its length plus 1 in the depth arrays, for the -1 of blocks reaching its end.
+**/
+void GeneCoverageTallyer::buildDepthSegments(const int refIdx, const vector< GeneCoord >& refGenes){
+
+	if(depthSegments.size() <= refIdx){
+		depthSegments.resize(refIdx + 1);
+		depthLens.resize(refIdx + 1, 0);
+	}
+	vector< DepthSegment >& segments = depthSegments[refIdx];
+	size_t depthLen = 0;
+
+	// Genes are sorted by start, so spans can be merged in a single sweep
+	for(int geneI = 0; geneI < refGenes.size(); geneI++){
+		unsigned int spanStart = 0;
+		if(refGenes[geneI].start > updown){
+			spanStart = refGenes[geneI].start - updown;
+		}
+		const unsigned int spanEnd = refGenes[geneI].end + updown;
+		if(!segments.empty() && spanStart <= segments.back().end){
+			segments.back().end = max(segments.back().end, spanEnd);
+		}else{
+			if(!segments.empty()){
+				depthLen = segments.back().offset + (segments.back().end - segments.back().start) + 1;
+			}
+			segments.push_back(DepthSegment(spanStart, spanEnd, depthLen));
+		}
+	}
+	if(!segments.empty()){
+		depthLen = segments.back().offset + (segments.back().end - segments.back().start) + 1;
+	}
+	depthLens[refIdx] = depthLen;
+
+	// Each gene lies within one segment
+	int segI = 0;
+	for(int geneI = 0; geneI < refGenes.size(); geneI++){
+		unsigned int spanStart = 0;
+		if(refGenes[geneI].start > updown){
+			spanStart = refGenes[geneI].start - updown;
+		}
+		while(segments[segI].end <= spanStart){
+			segI++;
 		}
+		geneDepthStarts.push_back(segments[segI].offset + (spanStart - segments[segI].start));
+	}
+	return;
+}
+
+
+/*** Summarise a sample's depth per gene, then free its depth arrays
+** Done as each sample finishes, so only samples still being tallied hold depth arrays.
+**/
+void GeneCoverageTallyer::summariseDepth(SampleTally& tally){
+
+	tally.meanDepths.assign(numGenes, 0);
+	tally.medianDepths.assign(numGenes, 0);
+	tally.breadths.assign(numGenes, 0);
+	vector< int > spanDepths;
+	for(CoordMap::const_iterator aRef=geneCoords.begin(); aRef!=geneCoords.end(); ++aRef){
+		const vector< GeneCoord >& refGenes = aRef->second;
+		const int refIdx = refIndexes.find(aRef->first)->second;
+		const unsigned int geneOffset = geneOffsets[refIdx];
+
+		// Sum depth changes into per-base depth.  Every segment's changes sum to 0, so one running total will do.
+		vector< int >& depths = tally.depthDiffs[refIdx];
+		int depth = 0;
+		for(size_t i=0; i < depths.size(); i++){
+			depth += depths[i];
+			depths[i] = depth;
+		}
+
+		for(int geneI = 0; geneI < refGenes.size(); geneI++){
+			unsigned int spanStart = 0;
+			if(refGenes[geneI].start > updown){
+				spanStart = refGenes[geneI].start - updown;
+			}
+			const unsigned int spanLen = refGenes[geneI].end + updown - spanStart;
+			const unsigned int geneNum = geneOffset + geneI;
+			getGeneDepthStats(depths, geneDepthStarts[geneNum], spanLen, spanDepths, tally.meanDepths[geneNum], tally.medianDepths[geneNum], tally.breadths[geneNum]);
+		}
+		vector< int >().swap(depths);
+	}
+	return;
+}
+
+
+/*** Summarise per-base depth over a gene span: mean, median and fraction at breadthDepth or more
+**/
+void GeneCoverageTallyer::getGeneDepthStats(const vector< int >& depths, const size_t spanStart, const unsigned int spanLen, vector< int >& spanDepths, double& meanDepth, double& medianDepth, double& breadth){
+
+	meanDepth = 0;
+	medianDepth = 0;
+	breadth = 0;
+	if(spanLen == 0){
+		return;
+	}
+	double depthSum = 0;
+	unsigned int basesCovered = 0;
+	if(depths.empty()){
+		// No reads reached the refSeq
+		spanDepths.assign(spanLen, 0);
+	}else{
+		spanDepths.assign(depths.begin() + spanStart, depths.begin() + spanStart + spanLen);
+	}
+	for(unsigned int i=0; i < spanLen; i++){
+		depthSum += spanDepths[i];
+		if(spanDepths[i] >= breadthDepth){
+			basesCovered++;
+		}
+	}
+	meanDepth = depthSum / spanLen;
+	breadth = (double)basesCovered / spanLen;
+
+	const unsigned int mid = spanLen / 2;
+	nth_element(spanDepths.begin(), spanDepths.begin() + mid, spanDepths.end());
+	medianDepth = spanDepths[mid];
+	if(spanLen % 2 == 0){
+		medianDepth = (medianDepth + *max_element(spanDepths.begin(), spanDepths.begin() + mid)) / 2;
+	}
+	return;
+}
+
+
+/*** Write a read count to output, with a leading tab.  Fractional counts to 2 decimal places.
+**/
+void GeneCoverageTallyer::writeCount(const double count){
+	if(fractionalNH){
+		const streamsize oldPrecision = outtabfile.precision(2);
+		outtabfile << "\t" << fixed << count;
+		outtabfile.unsetf(ios_base::floatfield);
+		outtabfile.precision(oldPrecision);
+	}else{
+		outtabfile << "\t" << (unsigned int)count;
 	}
 	return;
 }
@@ -311,31 +1140,53 @@ bool GeneCoverageTallyer::writeOutput(){
 	
 	outtabfile << "Gene\tRefID\tStart\tEnd";
 	for(int sNum=0; sNum < numSamples; sNum++){
-		outtabfile << "\t" << labels[sNum];
+		if(depthMode){
+			outtabfile << "\t" << labels[sNum] << "_reads";
+			outtabfile << "\t" << labels[sNum] << "_meanDepth";
+			outtabfile << "\t" << labels[sNum] << "_medianDepth";
+			outtabfile << "\t" << labels[sNum] << "_breadth" << breadthDepth << "x";
+		}else{
+			outtabfile << "\t" << labels[sNum];
+		}
 	}
 	outtabfile << "\n";
 
+	// Counts are held sample-major, transposed to a row per gene here
+	vector< double > geneRow(numSamples, 0);
 	for(CoordMap::iterator aRef=geneCoords.begin(); aRef!=geneCoords.end(); ++aRef){
-		string refID = aRef->first;
+		const string& refID = aRef->first;
+		const vector< GeneCoord >& refGenes = aRef->second;
+		const int refIdx = refIndexes[refID];
+		const unsigned int geneOffset = geneOffsets[refIdx];
 
-		for(int geneI = 0; geneI < geneCoords[refID].size(); geneI++ ){
+		for(int geneI = 0; geneI < refGenes.size(); geneI++ ){
 
 			// Check if minimum reads met for printing
 			bool doPrint = false;
-			for(int sNum=0; sNum < numSamples && !doPrint; sNum++){
-				if(readCounts[refID][geneI][sNum] >= minReads){
+			for(int sNum=0; sNum < numSamples; sNum++){
+				geneRow[sNum] = sampleTallies[sNum].geneCounts[geneOffset + geneI];
+				if(geneRow[sNum] >= minReads){
 					doPrint = true;
 				}
 			}
 
 			// Output for a gene
 			if(doPrint){
-				outtabfile << geneCoords[refID][geneI].name << "\t";
+				outtabfile << refGenes[geneI].name << "\t";
 				outtabfile << refID << "\t";
-				outtabfile << geneCoords[refID][geneI].start << "\t";
-				outtabfile << geneCoords[refID][geneI].end;
-				for(int sNum=0; sNum < numSamples; sNum++){
-					outtabfile << "\t" << readCounts[refID][geneI][sNum];
+				outtabfile << refGenes[geneI].start << "\t";
+				outtabfile << refGenes[geneI].end;
+				if(depthMode){
+					const unsigned int geneNum = geneOffset + geneI;
+					for(int sNum=0; sNum < numSamples; sNum++){
+						const SampleTally& tally = sampleTallies[sNum];
+						writeCount(geneRow[sNum]);
+						outtabfile << "\t" << tally.meanDepths[geneNum] << "\t" << tally.medianDepths[geneNum] << "\t" << tally.breadths[geneNum];
+					}
+				}else{
+					for(int sNum=0; sNum < numSamples; sNum++){
+						writeCount(geneRow[sNum]);
+					}
 				}
 				outtabfile << "\n";
 			}
@@ -343,5 +1194,5 @@ bool GeneCoverageTallyer::writeOutput(){
 	}
 
 	outtabfile.close();
+	return true;
 }
-
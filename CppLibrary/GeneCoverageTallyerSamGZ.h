@@ -14,6 +14,7 @@
 #include <algorithm>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
+#include "IntervalIndex.h"
 using namespace std;
 
 /* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
@@ -24,11 +25,14 @@ struct GeneCoord {
 	string name;
 	unsigned int start;
 	unsigned int end;
+	char strand; //!< '+', '-', or '.' if unknown
+	vector< pair< unsigned int, unsigned int > > exons; //!< Merged exons (half-open), from annotation inputs only
 
 	GeneCoord(unsigned int newStart, unsigned int newEnd, const string& newName){
 		name = newName;
 		start = newStart;
 		end = newEnd;
+		strand = '.';
 	}
 
 	bool operator < (const GeneCoord& otherGene) const{
@@ -37,40 +41,211 @@ struct GeneCoord {
 }; //!< gene start, gene end, gene name
 
 typedef map< string, vector< GeneCoord > > CoordMap; //!< refSeqID, list of gene details
-typedef map< string, vector< vector< unsigned int > > > ReadCountMap; //!< refSeqID, read counts per gene per sample
+
+struct ExonSpan {
+	unsigned int start;
+	unsigned int end;
+	int geneI;
+
+	ExonSpan(unsigned int newStart, unsigned int newEnd, int newGeneI){
+		start = newStart;
+		end = newEnd;
+		geneI = newGeneI;
+	}
+}; //!< Exon (half-open, including any up/down-stream extra) and its gene's index on the refSeq
+
+struct AnnotatedGene {
+	char strand;
+	vector< pair< unsigned int, unsigned int > > exons;
+
+	AnnotatedGene(){
+		strand = '.';
+	}
+}; //!< Gene strand and exons as read from an annotation
+
+typedef map< string, map< string, AnnotatedGene > > ExonMap; //!< refSeqID, geneID, gene as read from an annotation
+
+struct DepthSegment {
+	unsigned int start;
+	unsigned int end;
+	size_t offset;
+
+	DepthSegment(unsigned int newStart, unsigned int newEnd, size_t newOffset){
+		start = newStart;
+		end = newEnd;
+		offset = newOffset;
+	}
+}; //!< Merged span of overlapping genes on a refSeq (half-open), and where it starts in a sample's depth array for the refSeq
+
+/*** Read tally for a sample, kept apart from other samples' so each thread writes only its own counts.
+** Genes are numbered across all refSeqs (refSeq gene offset + gene index), so counts are one contiguous array.
+**/
+struct SampleTally {
+	vector< double > geneCounts; //!< Read counts per gene, fractional if counting multimappers as 1/NH
+	unsigned int totReads; //!< Reads parsed that aligned to a refSeq with genes
+	string lastRefID; //!< RefSeq of the last read parsed...
+	int lastRefIdx; //!< ...and its index, to skip a lookup for runs of reads on the same refSeq
+	vector<int> geneHits; //!< Working list of genes overlapping a read
+	vector< vector< int > > depthDiffs; //!< Depth mode only, per refSeq index, change in read depth at each position of its gene spans.  Allocated on the first read to reach a refSeq, freed once summarised
+	vector< double > meanDepths; //!< Depth mode only, per gene, summarised once the sample's reads are tallied...
+	vector< double > medianDepths;
+	vector< double > breadths;
+	vector< pair< unsigned int, unsigned int > > alignedBlocks; //!< Depth mode or annotation inputs, working list of a read's aligned blocks (half-open)
+	vector<int> exonHits; //!< Working list of genes hit by all aligned blocks so far, strict exon-aware counting
+	vector<int> blockGenes; //!< Working list of genes hit by an aligned block
+
+	SampleTally(){
+		totReads = 0;
+		lastRefIdx = -1;
+	}
+
+	void init(const unsigned int numGenes, const unsigned int numDepthRefs){
+		geneCounts.assign(numGenes, 0);
+		depthDiffs.assign(numDepthRefs, vector< int >());
+		totReads = 0;
+		lastRefID.clear();
+		lastRefIdx = -1;
+	}
+
+	/*** Add another tally's counts, taking or freeing its depth arrays **/
+	void add(SampleTally& other){
+		for(unsigned int i=0; i < geneCounts.size(); i++){
+			geneCounts[i] += other.geneCounts[i];
+		}
+		for(unsigned int refIdx=0; refIdx < depthDiffs.size(); refIdx++){
+			vector< int >& otherDiffs = other.depthDiffs[refIdx];
+			vector< int >& diffs = depthDiffs[refIdx];
+			if(diffs.empty()){
+				diffs.swap(otherDiffs);
+			}else if(!otherDiffs.empty()){
+				for(size_t i=0; i < diffs.size(); i++){
+					diffs[i] += otherDiffs[i];
+				}
+				vector< int >().swap(otherDiffs);
+			}
+		}
+		totReads += other.totReads;
+	}
+};
+
+struct GeneHitCounter {
+	double* refCounts; //!< Read counts of the refSeq's genes
+	const char* refStrands; //!< Strand of each of the refSeq's genes, NULL to count reads from either strand
+	char wantStrand; //!< Gene strand a read counts towards, genes of unknown strand ('.') count either
+	double weight;
+
+	void operator()(const int geneI){
+		if(refStrands == NULL || refStrands[geneI] == wantStrand || refStrands[geneI] == '.'){
+			refCounts[geneI] += weight;
+		}
+	}
+}; //!< IntervalIndex visitor, adds a read to the count of each gene it overlaps
+
+struct BlockGeneGatherer {
+	const vector< ExonSpan >* exons; //!< Exons of the refSeq
+	unsigned int bStart;
+	unsigned int bEnd;
+	bool strictOverlap; //!< Only gather genes with an exon holding the whole block
+	vector<int>* blockGenes; //!< Genes hit by the block
+
+	void operator()(const int exonI){
+		const ExonSpan& exon = (*exons)[exonI];
+		if(!strictOverlap || (exon.start <= bStart && bEnd <= exon.end)){
+			blockGenes->push_back(exon.geneI);
+		}
+	}
+}; //!< IntervalIndex visitor, gathers genes with an exon overlapped by an aligned block
 
 class GeneCoverageTallyer {
   private:
+	enum StrandMode { strandEither, strandSame, strandReverse }; //!< Strand-specific counting, as resolved from strandMode
+	
   	int minReads; //!< Minimum reads seen in any one sample to make it worth printing results for a coordinate range
 	int updown; //!< Extra bases to include up/down-stream of gene coordinates
+	string strandMode; //!< Strand-specific counting: no, yes (read strand matches gene), or reverse (read strand opposite gene)
+	StrandMode strandCounting; //!< strandMode resolved once, for per-read tests
+	int excludeFlags; //!< Skip reads with any of these SAM FLAG bits set (unmapped reads are always skipped)
+	bool fractionalNH; //!< Count a read aligned to NH places as 1/NH
+	bool taggedLines; //!< Also tally SAM lines with optional tags (more than 11 columns), else only lines of exactly 11 columns
+	int threadsPerSample; //!< Worker threads used to parse and tally reads within each sample
+	bool depthMode; //!< Also report per-base depth and coverage breadth over each gene
+	int breadthDepth; //!< Depth mode, minimum read depth for a base to count towards coverage breadth
+	static const int lineBatchSize = 4096; //!< Lines per batch handed to a worker, reading plain gzip with threadsPerSample > 1
 	vector<string> inSAMFileNames; //!< List of SAM alignment files for input
 	vector<string> labels;  //!< List of sample names, one for each corresponding SAM input file
 	string inCoordFileName; //!< Coordinate input file for tallying over
+	string coordsFormat; //!< Format of coords file: tab, gtf, gff3 or bed
+	bool exonAware; //!< Count reads by exon overlaps of aligned blocks, for annotation coords formats
+	bool strictOverlap; //!< Exon-aware counting, only count reads with every aligned block inside an exon of the gene (else any block overlapping one)
+	bool recordBlocks; //!< Record aligned blocks of each read, for depth mode or exon-aware counting
 	int numSamples; //!< Number of input samples == number of SAM file inputs
 	ofstream outtabfile; //!< Tabular output file name
 	bool prepRan;  //!< Indicates that class has been initialised, output files have been opened and GeneCoverageTallyer is ready to run
 	
 	CoordMap geneCoords; //!< List of all starting coord positions, as read from input file
-	ReadCountMap readCounts; //!< Read counts per refSeq, per gene, per sample
-	unsigned int maxGene; //!< Largest gene size witnessed in gene list
+	map< string, int > refIndexes; //!< Index number of each refSeq with genes, in geneCoords order
+	vector< IntervalIndex > geneIndexes; //!< Overlap index of genes (including up/down-stream extra) per refSeq index
+	vector< vector< ExonSpan > > refExons; //!< Exon-aware counting, merged exons of all genes per refSeq index
+	vector< IntervalIndex > exonIndexes; //!< Exon-aware counting, overlap index of refExons per refSeq index
+	vector< char > geneStrands; //!< Strand of each gene, by gene number
+	vector< unsigned int > geneOffsets; //!< Number of first gene of each refSeq index, in gene numbering across all refSeqs
+	unsigned int numGenes; //!< Total genes across all refSeqs
+	vector< SampleTally > sampleTallies; //!< Read counts per sample, per gene
+	vector< vector< DepthSegment > > depthSegments; //!< Depth mode, merged gene spans per refSeq index
+	vector< size_t > geneDepthStarts; //!< Depth mode, start of each gene's span in its refSeq's depth arrays, by gene number
+	vector< size_t > depthLens; //!< Depth mode, length of per-sample depth arrays per refSeq index (merged gene spans, plus 1 position each)
 	
 		/*** Actual constructor code, called by constructor forms **/
-	void prepareCoverageTallyer(const vector<string>& aLabelsList, const vector<string>& aSAMFileNamesList, const string& aCoordFileName, const string& aOutTabFileName, const int& aMinReads, const int& aUpDown);
+	void prepareCoverageTallyer(const vector<string>& aLabelsList, const vector<string>& aSAMFileNamesList, const string& aCoordFileName, const string& aOutTabFileName, const int& aMinReads, const int& aUpDown, const int& aThreadsPerSample, const bool& aDepthMode, const int& aBreadthDepth, const string& aCoordsFormat, const bool& aStrictOverlap, const string& aStrandMode, const int& aExcludeFlags, const bool& aFractionalNH, const bool& aTaggedLines);
 		/*** Read coords list to form list of test coordinates.  Also initialises read count tables. **/
 	bool loadCoordsList();
+		/*** Read a tab-separated coords list of refID, start, end, gene name **/
+	void loadTabCoords(ifstream& infile);
+		/*** Read exons from a GTF or GFF3 annotation, grouped by gene **/
+	void loadGTFCoords(ifstream& infile, const bool isGFF3);
+		/*** Read blocks from a BED (BED12 or fewer columns) annotation, grouped by name **/
+	void loadBEDCoords(ifstream& infile);
+		/*** Merge each gene's exons and add genes to geneCoords **/
+	void addAnnotationGenes(ExonMap& geneExons);
 		/*** Read the sam.gz file to tally reads for a specific sample **/
 	bool tallyReadsForSample(const int sNum);
-		/*** Test if a line is SAM format aligned read then extract read coordinates **/
-	bool getReadCoordFromSamLine(const string& line, unsigned int& rStart, unsigned int& rEnd, string& rRefID);
+		/*** Tally reads for a sample from a plain gzip file, one reader thread passing batches of lines to workers **/
+	bool tallyReadsStreamed(const int sNum, vector< SampleTally >& workerTallies);
+		/*** Tally reads for a sample from a BGZF file, each worker taking a range of compressed blocks **/
+	bool tallyReadsBGZF(const int sNum, const vector< unsigned long long >& blockOffsets, vector< SampleTally >& workerTallies);
+		/*** Tally the reads in one worker's range of BGZF blocks, plus the line running over the end of the range **/
+	bool tallyBGZFRange(const string& inFileName, const vector< unsigned long long >& blockOffsets, const int firstBlock, const int endBlock, SampleTally& tally);
+		/*** List the file offset of every block if a file is BGZF (blocked gzip), with file size at end **/
+	bool getBGZFBlocks(const string& inFileName, vector< unsigned long long >& blockOffsets);
+		/*** Decompress one BGZF block **/
+	bool inflateBGZFBlock(ifstream& infile, const vector< unsigned long long >& blockOffsets, const int blockNum, string& compressed, string& data);
+		/*** Tally a single line of SAM **/
+	void tallySamLine(const string& line, SampleTally& tally);
+		/*** Test if a line is SAM format aligned read then extract read coordinates and refSeq index **/
+	bool getReadCoordFromSamLine(const string& line, unsigned int& rStart, unsigned int& rEnd, int& rRefIdx, char& rStrand, int& rNumHits, SampleTally& tally);
 		/*** Test if a read overlaps a gene, add it to the tally **/
-	void addReadTally(const unsigned int& rStart, const unsigned int& rEnd, const string& rRefID, const int sNum);
+	void addReadTally(const unsigned int& rStart, const unsigned int& rEnd, const int rRefIdx, const char rStrand, const double weight, SampleTally& tally);
+		/*** Add a read to the tally of each gene hit, where strands agree **/
+	void countGeneHits(const int rRefIdx, const char rStrand, const double weight, SampleTally& tally);
+		/*** Test which genes a read's aligned blocks hit exons of, add it to the tally **/
+	void addReadExonTally(const int rRefIdx, const char rStrand, const double weight, SampleTally& tally);
+		/*** Add a read's aligned blocks to the depth tally, where they fall in gene spans **/
+	void addReadDepth(const int rRefIdx, SampleTally& tally);
+		/*** Merge a refSeq's overlapping gene spans into depth segments **/
+	void buildDepthSegments(const int refIdx, const vector< GeneCoord >& refGenes);
+		/*** Summarise a sample's depth per gene, then free its depth arrays **/
+	void summariseDepth(SampleTally& tally);
+		/*** Summarise per-base depth over a gene span **/
+	void getGeneDepthStats(const vector< int >& depths, const size_t spanStart, const unsigned int spanLen, vector< int >& spanDepths, double& meanDepth, double& medianDepth, double& breadth);
+		/*** Write a read count to output **/
+	void writeCount(const double count);
 		/*** Finalise results to file **/
 	bool writeOutput();
 		
   public:
 		/** Initialise with no defaults **/
 	GeneCoverageTallyer(const vector<string>& aLabelsList, const vector<string>& aSAMFileNamesList, const string& aCoordFileName, const string& aOutTabFileName);
-	GeneCoverageTallyer(const vector<string>& aLabelsList, const vector<string>& aSAMFileNamesList, const string& aCoordFileName, const string& aOutTabFileName, const int& aMinReads, const int& aUpDown);
+	GeneCoverageTallyer(const vector<string>& aLabelsList, const vector<string>& aSAMFileNamesList, const string& aCoordFileName, const string& aOutTabFileName, const int& aMinReads, const int& aUpDown, const int& aThreadsPerSample, const bool& aDepthMode, const int& aBreadthDepth, const string& aCoordsFormat, const bool& aStrictOverlap, const string& aStrandMode, const int& aExcludeFlags, const bool& aFractionalNH, const bool& aTaggedLines);
 	~GeneCoverageTallyer();
 	
 		/** Launch the full read tallying process **/
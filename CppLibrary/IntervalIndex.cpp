@@ -0,0 +1,134 @@
+#include <vector>
+#include <algorithm>
+#include "IntervalIndex.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/* Implicit interval tree layout after Heng Li's cgranges:
+** a node at array index i sits at level k = number of trailing 1-bits of i,
+** leaves are even indices, and node i's children are i - 2^(k-1) and i + 2^(k-1). */
+
+IntervalIndex::IntervalIndex(){
+	maxShortLen = 0;
+	maxLevel = -1;
+	numIntervals = 0;
+	indexed = true;
+}
+
+/*** Add an interval [start, end) with a value, invalidating the index
+**/
+void IntervalIndex::add(unsigned int start, unsigned int end, int value){
+	Interval newInterval;
+	newInterval.start = start;
+	newInterval.end = end;
+	newInterval.maxEnd = end;
+	newInterval.value = value;
+	if(indexed && numIntervals > 0){
+		// Re-gather intervals for re-indexing
+		intervals.insert(intervals.end(), shortIntervals.begin(), shortIntervals.end());
+		shortIntervals.clear();
+	}
+	intervals.push_back(newInterval);
+	numIntervals++;
+	indexed = false;
+}
+
+/*** Sort and augment intervals, ready for queries
+**/
+void IntervalIndex::index(){
+	if(indexed){
+		return;
+	}
+	indexed = true;
+	
+	// Length cut-off between short and long intervals
+	maxShortLen = 0;
+	if(!intervals.empty()){
+		vector<unsigned int> lengths(intervals.size());
+		for(int i=0; i < intervals.size(); i++){
+			lengths[i] = intervals[i].end - intervals[i].start;
+		}
+		const int cutI = (lengths.size() - 1) * longPercentile / 100;
+		nth_element(lengths.begin(), lengths.begin() + cutI, lengths.end());
+		unsigned long long cutLen = (unsigned long long)lengths[cutI] * longFactor;
+		maxShortLen = (cutLen > 0xFFFFFFFFULL) ? 0xFFFFFFFFU : cutLen;
+	}
+	
+	vector<Interval> longIntervals;
+	shortIntervals.clear();
+	unsigned int longestShort = 0;
+	for(int i=0; i < intervals.size(); i++){
+		const unsigned int len = intervals[i].end - intervals[i].start;
+		if(len <= maxShortLen){
+			shortIntervals.push_back(intervals[i]);
+			if(len > longestShort){
+				longestShort = len;
+			}
+		}else{
+			longIntervals.push_back(intervals[i]);
+		}
+	}
+	maxShortLen = longestShort;
+	intervals.swap(longIntervals);
+	stable_sort(shortIntervals.begin(), shortIntervals.end());
+	stable_sort(intervals.begin(), intervals.end());
+	indexTree();
+}
+
+/*** Augment the sorted long intervals as an implicit interval tree
+**/
+void IntervalIndex::indexTree(){
+	const long long n = intervals.size();
+	if(n == 0){
+		maxLevel = -1;
+		return;
+	}
+	
+	// Leaves
+	long long lastI = 0;
+	unsigned int lastMax = 0;
+	for(long long i=0; i < n; i += 2){
+		lastI = i;
+		lastMax = intervals[i].maxEnd = intervals[i].end;
+	}
+	
+	// Internal nodes, level by level.  Right children beyond the array take the max of the last node present.
+	int k;
+	for(k=1; (1LL << k) <= n; k++){
+		const long long x = 1LL << (k-1);
+		const long long step = x << 2;
+		for(long long i = (x << 1) - 1; i < n; i += step){
+			unsigned int maxEnd = intervals[i].end;
+			const unsigned int leftMax = intervals[i - x].maxEnd;
+			const unsigned int rightMax = (i + x < n) ? intervals[i + x].maxEnd : lastMax;
+			if(leftMax > maxEnd){
+				maxEnd = leftMax;
+			}
+			if(rightMax > maxEnd){
+				maxEnd = rightMax;
+			}
+			intervals[i].maxEnd = maxEnd;
+		}
+		lastI = ((lastI >> k) & 1) ? lastI - x : lastI + x;
+		if(lastI < n && intervals[lastI].maxEnd > lastMax){
+			lastMax = intervals[lastI].maxEnd;
+		}
+	}
+	maxLevel = k - 1;
+}
+
+/*** Append values of all intervals overlapping [qStart, qEnd) to values, returns number found
+**/
+int IntervalIndex::overlap(unsigned int qStart, unsigned int qEnd, vector<int>& values) const{
+	ValueAppender appender(values);
+	return visitOverlaps(qStart, qEnd, appender);
+}
+
+/*** Number of intervals held
+**/
+int IntervalIndex::size() const{
+	return numIntervals;
+}
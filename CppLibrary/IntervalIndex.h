@@ -0,0 +1,167 @@
+#ifndef INTERVALINDEX_H
+#define INTERVALINDEX_H
+
+#include <vector>
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/*** Overlap index over a set of intervals, each carrying an integer value (e.g. a gene number).
+** Most intervals are held sorted by start and found by binary search then a short forward scan,
+** bounded by the longest of these.  Outliers, over 4x the 99th percentile length, are held apart, laid out as an implicit binary
+** tree over their sorted array with each node augmented by the largest end in its subtree, so a few
+** very long intervals cannot widen the scan.  Query cost therefore does not depend on the longest interval.
+** Intervals are half-open: [start, end).
+**/
+class IntervalIndex {
+	struct Interval {
+		unsigned int start;
+		unsigned int end;
+		unsigned int maxEnd; //!< Largest end in the subtree rooted at this interval
+		int value;
+		
+		bool operator < (const Interval& other) const{
+			return (start < other.start);
+		}
+	};
+	
+	static const int longPercentile = 99; //!< Intervals longer than longFactor times this percentile of lengths go in the tree
+	static const int longFactor = 4;
+	
+	vector<Interval> intervals; //!< Intervals as added, then the long intervals as an implicit tree once indexed
+	vector<Interval> shortIntervals; //!< Intervals up to maxShortLen, sorted by start once indexed
+	unsigned int maxShortLen; //!< Longest interval in shortIntervals
+	int maxLevel; //!< Level of the root of the implicit tree
+	int numIntervals; //!< Total intervals held
+	bool indexed; //!< Indicates that intervals are sorted and augmented, ready for queries
+	
+		/*** Augment the sorted long intervals as an implicit interval tree **/
+	void indexTree();
+		/*** Call visit(value) for each long interval overlapping [qStart, qEnd) **/
+	template <class Visitor>
+	int visitTree(unsigned int qStart, unsigned int qEnd, Visitor& visit) const;
+	
+		/*** Appends each value visited to a list **/
+	struct ValueAppender {
+		vector<int>& values;
+		ValueAppender(vector<int>& aValues) : values(aValues) {}
+		void operator()(const int value){
+			values.push_back(value);
+		}
+	};
+	
+  public:
+	IntervalIndex();
+		/*** Add an interval [start, end) with a value, invalidating the index **/
+	void add(unsigned int start, unsigned int end, int value);
+		/*** Sort and augment intervals, ready for queries **/
+	void index();
+		/*** Append values of all intervals overlapping [qStart, qEnd) to values, returns number found **/
+	int overlap(unsigned int qStart, unsigned int qEnd, vector<int>& values) const;
+		/*** Call visit(value) for each interval overlapping [qStart, qEnd), returns number found.
+		** Inlined into the caller, so per-query hits need not be gathered into a list first. **/
+	template <class Visitor>
+	int visitOverlaps(unsigned int qStart, unsigned int qEnd, Visitor& visit) const;
+		/*** Number of intervals held **/
+	int size() const;
+};
+
+/*** Call visit(value) for each interval overlapping [qStart, qEnd), returns number found
+**/
+template <class Visitor>
+int IntervalIndex::visitOverlaps(unsigned int qStart, unsigned int qEnd, Visitor& visit) const{
+	if(!indexed){
+		return 0;
+	}
+	int found = 0;
+	
+	// Short intervals: skip those ending before the query could start, then scan
+	int lowBound = 0;
+	int highBound = shortIntervals.size();
+	while(lowBound != highBound){
+		int midpoint = (lowBound + highBound) / 2;
+		if( (unsigned long long)shortIntervals[midpoint].start + maxShortLen <= qStart ){
+			lowBound = midpoint + 1;
+		}else{
+			highBound = midpoint;
+		}
+	}
+	const int numShort = shortIntervals.size();
+	for(int i=lowBound; i < numShort && shortIntervals[i].start < qEnd; i++){
+		if(qStart < shortIntervals[i].end){
+			visit(shortIntervals[i].value);
+			found++;
+		}
+	}
+	
+	if(intervals.empty()){
+		return found;
+	}
+	return found + visitTree(qStart, qEnd, visit);
+}
+
+/*** Call visit(value) for each long interval overlapping [qStart, qEnd)
+**/
+template <class Visitor>
+int IntervalIndex::visitTree(unsigned int qStart, unsigned int qEnd, Visitor& visit) const{
+	int found = 0;
+	const long long n = intervals.size();
+	
+	struct StackItem {
+		int level;
+		long long node;
+		bool leftDone;
+	};
+	StackItem stack[64];
+	int top = 0;
+	stack[top].level = maxLevel;
+	stack[top].node = (1LL << maxLevel) - 1;
+	stack[top].leftDone = false;
+	top++;
+	
+	while(top > 0){
+		const StackItem item = stack[--top];
+		if(item.level <= 3){
+			// Small subtree, scan it linearly
+			const long long i0 = item.node >> item.level << item.level;
+			long long i1 = i0 + (1LL << (item.level + 1)) - 1;
+			if(i1 >= n){
+				i1 = n;
+			}
+			for(long long i = i0; i < i1 && intervals[i].start < qEnd; i++){
+				if(qStart < intervals[i].end){
+					visit(intervals[i].value);
+					found++;
+				}
+			}
+		}else if(!item.leftDone){
+			// Revisit this node once its left subtree is done, descending left only if it can overlap
+			const long long left = item.node - (1LL << (item.level - 1));
+			stack[top].level = item.level;
+			stack[top].node = item.node;
+			stack[top].leftDone = true;
+			top++;
+			if(left >= n || intervals[left].maxEnd > qStart){
+				stack[top].level = item.level - 1;
+				stack[top].node = left;
+				stack[top].leftDone = false;
+				top++;
+			}
+		}else if(item.node < n && intervals[item.node].start < qEnd){
+			// This node, then its right subtree
+			if(qStart < intervals[item.node].end){
+				visit(intervals[item.node].value);
+				found++;
+			}
+			stack[top].level = item.level - 1;
+			stack[top].node = item.node + (1LL << (item.level - 1));
+			stack[top].leftDone = false;
+			top++;
+		}
+	}
+	return found;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#include <vector>
+#include <stdint.h>
+#include "KmerBloomFilter.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+KmerBloomFilter::KmerBloomFilter(){
+	init(0);
+}
+
+/*** Empty the filter, sized for this many k-mers
+**/
+void KmerBloomFilter::init(size_t numKmers){
+	size_t numBlocks = 1;
+	while(numBlocks * wordsPerBlock * 64 < numKmers * bitsPerKmer){
+		numBlocks *= 2;
+	}
+	bits.assign(numBlocks * wordsPerBlock, 0);
+	blockMask = numBlocks - 1;
+}
+
+/*** 64-bit mix of a key (splitmix64 finaliser)
+**/
+uint64_t KmerBloomFilter::mixKey(uint64_t key){
+	key += 0x9e3779b97f4a7c15ULL;
+	key ^= key >> 30;
+	key *= 0xbf58476d1ce4e5b9ULL;
+	key ^= key >> 27;
+	key *= 0x94d049bb133111ebULL;
+	key ^= key >> 31;
+	return key;
+}
+
+/*** Add a k-mer
+** Block from the low bits of the mix, bit positions in the block by double hashing on the high bits
+**/
+void KmerBloomFilter::add(uint64_t key){
+	const uint64_t hash = mixKey(key);
+	uint64_t* block = &bits[(hash & blockMask) * wordsPerBlock];
+	uint32_t bitPos = hash >> 32;
+	const uint32_t step = ((hash >> 41) & 511) | 1;
+	for(int i=0; i < numHashes; i++){
+		block[(bitPos >> 6) & 7] |= (1ULL << (bitPos & 63));
+		bitPos += step;
+	}
+}
+
+/*** False if k-mer certainly not added, true if it probably was
+**/
+bool KmerBloomFilter::mayContain(uint64_t key) const{
+	const uint64_t hash = mixKey(key);
+	const uint64_t* block = &bits[(hash & blockMask) * wordsPerBlock];
+	uint32_t bitPos = hash >> 32;
+	const uint32_t step = ((hash >> 41) & 511) | 1;
+	for(int i=0; i < numHashes; i++){
+		if(!(block[(bitPos >> 6) & 7] & (1ULL << (bitPos & 63)))){
+			return false;
+		}
+		bitPos += step;
+	}
+	return true;
+}
+
+/*** Bytes held by the filter
+**/
+size_t KmerBloomFilter::memBytes() const{
+	return bits.capacity() * sizeof(uint64_t);
+}
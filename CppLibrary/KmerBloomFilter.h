@@ -0,0 +1,39 @@
+#ifndef KMERBLOOMFILTER_H
+#define KMERBLOOMFILTER_H
+
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/*** Blocked Bloom filter of 2-bit encoded k-mers (see KmerHashTable), for quickly ruling out k-mers not held.
+** All of a k-mer's bits fall in one 512-bit block, so a lookup touches a single cache line.
+** About 10 bits per k-mer, giving roughly a 1% false positive rate; never a false negative.
+**/
+class KmerBloomFilter {
+	static const int bitsPerKmer = 10;
+	static const int numHashes = 7;
+	static const int wordsPerBlock = 8; //!< 512-bit blocks
+
+	vector<uint64_t> bits;
+	uint64_t blockMask; //!< Number of blocks - 1, number of blocks being a power of 2
+
+		/*** 64-bit mix of a key (splitmix64 finaliser) **/
+	static uint64_t mixKey(uint64_t key);
+
+  public:
+	KmerBloomFilter();
+		/*** Empty the filter, sized for this many k-mers **/
+	void init(size_t numKmers);
+		/*** Add a k-mer **/
+	void add(uint64_t key);
+		/*** False if k-mer certainly not added, true if it probably was **/
+	bool mayContain(uint64_t key) const;
+		/*** Bytes held by the filter **/
+	size_t memBytes() const;
+};
+
+#endif
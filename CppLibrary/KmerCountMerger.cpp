@@ -1,3 +1,4 @@
+#include <omp.h>
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -6,12 +7,18 @@
 #include <string>
 #include <cstring>
 #include <ctype.h>
+#include <climits>
+#include <cstdlib>
 #include <sstream>
 #include <algorithm>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include "KmerCountMerger.h"
 #include "SeqReader.h"
+#include "KmerHashTable.h"
+#include "KmerRunSet.h"
+#include "KmerBloomFilter.h"
+#include "LineScanner.h"
 using namespace boost::iostreams;
 
 /* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
@@ -21,25 +28,49 @@ using namespace boost::iostreams;
 /*** Initialise with defaults 
 **/
 KmerCountMerger::KmerCountMerger(const vector<string>& aLabelsList, const vector<string>& aFileNamesList, const string& aOutTabFileName){
-	prepareKmerCountMerger(aLabelsList, aFileNamesList, aOutTabFileName, 20, false);
+	prepareKmerCountMerger(aLabelsList, aFileNamesList, aOutTabFileName, 20, false, "", 1024, 1, false);
 	return;
 }
 
-KmerCountMerger::KmerCountMerger(const vector<string>& aLabelsList, const vector<string>& aFileNamesList, const string& aOutTabFileName, const int& aMinCount, const bool& aTwoPassSet){
-	prepareKmerCountMerger(aLabelsList, aFileNamesList, aOutTabFileName, aMinCount, aTwoPassSet);
+KmerCountMerger::KmerCountMerger(const vector<string>& aLabelsList, const vector<string>& aFileNamesList, const string& aOutTabFileName, const int& aMinCount, const bool& aTwoPassSet, const string& aTempDir, const int& aMaxMemMB, const int& aNumShards, const bool& aCanonical){
+	prepareKmerCountMerger(aLabelsList, aFileNamesList, aOutTabFileName, aMinCount, aTwoPassSet, aTempDir, aMaxMemMB, aNumShards, aCanonical);
 	return;
 }
 
 /*** Actual constructor 
 **/
-void KmerCountMerger::prepareKmerCountMerger(const vector<string>& aLabelsList, const vector<string>& aFileNamesList, const string& aOutTabFileName, const int& aMinCount, const bool& aTwoPassSet){
+void KmerCountMerger::prepareKmerCountMerger(const vector<string>& aLabelsList, const vector<string>& aFileNamesList, const string& aOutTabFileName, const int& aMinCount, const bool& aTwoPassSet, const string& aTempDir, const int& aMaxMemMB, const int& aNumShards, const bool& aCanonical){
 
 	prepRan = false;
 	labels = aLabelsList;
 	inFileNames = aFileNamesList;
 	minCount = aMinCount;
 	twoPass = aTwoPassSet;
+	canonical = aCanonical;
+	// Canonical mode, a sample's two orientations of a kmer reach minCount only if one has at least half
+	firstPassMinCount = canonical ? (minCount + 1) / 2 : minCount;
+	tempDir = aTempDir;
+	maxMemBytes = (size_t)max(1, aMaxMemMB) * 1024 * 1024;
 	numSamples = labels.size();
+	kmerLen = 0;
+	kmerLenFixed = false;
+	outTabFileName = aOutTabFileName;
+	fileTypes.assign(numSamples, -1);
+	firstKmerSeqs.assign(numSamples, "");
+	lowCountSpills.assign(numSamples, NULL);
+
+	// Shards cover the kmers starting with each combination of shardBases leading bases
+	shardBases = 0;
+	while((1 << (2 * shardBases)) < aNumShards && shardBases < maxShardBases){
+		shardBases++;
+	}
+	const int numShards = 1 << (2 * shardBases);
+	shards.resize(numShards);
+	for(int shardNum=0; shardNum < numShards; shardNum++){
+		shards[shardNum].table.init(numSamples);
+		omp_init_lock(&shards[shardNum].lock);
+		shardPrefixes.push_back(KmerHashTable::decode(shardNum, shardBases));
+	}
 	
 	outtabfile.open(aOutTabFileName.c_str());
 	if(!outtabfile.is_open()){
@@ -56,6 +87,18 @@ KmerCountMerger::~KmerCountMerger(){
 	if(outtabfile.is_open()){
 		outtabfile.close();
 	}
+	for(int shardNum=0; shardNum < shards.size(); shardNum++){
+		omp_destroy_lock(&shards[shardNum].lock);
+	}
+	for(int sNum=0; sNum < lowCountSpills.size(); sNum++){
+		if(lowCountSpills[sNum] != NULL){
+			lowCountSpills[sNum]->keyFile.close();
+			lowCountSpills[sNum]->seqFile.close();
+			remove(lowCountSpills[sNum]->keyFileName.c_str());
+			remove(lowCountSpills[sNum]->seqFileName.c_str());
+			delete lowCountSpills[sNum];
+		}
+	}
 }
 
 /*** Launch the full kmer count merging process
@@ -65,45 +108,57 @@ bool KmerCountMerger::MergeKmerCounts(){
 	if(!prepRan){
 		return false;
 	}
+	if(tempDir != ""){
+		return mergeKmerCountsExternal();
+	}
+	// Sharded mode reads samples in parallel, with each sample's kmers routed to their shards
+	const int numShards = shards.size();
+	if(numShards > 1){
+		setKmerLenFromInputs();
+		shardBatches.assign(omp_get_max_threads(), vector< vector< ShardRecord > >(numShards));
+		cout << "Merging kmers in " << numShards << " shards" << endl;
+	}
+
+	// Two-pass mode holds kmers with minCount from the first pass, spilling lower counts to temp files
 	if(twoPass){
 		cout << "First pass..." << endl;
 	}
+	bool success = true;
+	#pragma omp parallel for schedule(dynamic) if(numShards > 1)
 	for(int sNum=0; sNum < numSamples; sNum++){
-		int fileType = testKmerFileForSample(sNum);
-		switch(fileType){
-			case 1:
-				if(!readTabCountsForSample(sNum, 1)){
-					cerr << "Failed to read kmers for " << labels[sNum] << " from tab file " << inFileNames[sNum] << endl;
-				}
-				break;
-			case 2:
-				if(!readFastaCountsForSample(sNum, 1)){
-					cerr << "Failed to read kmers for " << labels[sNum] << " from fasta file" << inFileNames[sNum] << endl;
-				}
-				break;
-			default:
-				cerr << "Failed to read kmers for " << labels[sNum] << " from file " << inFileNames[sNum] << endl;
+		if(twoPass && !openLowCountSpill(sNum)){
+			#pragma omp critical
+			success = false;
+			continue;
+		}
+		readKmerFileForSample(sNum);
+		if(numShards > 1){
+			for(int shardNum=0; shardNum < numShards; shardNum++){
+				flushShardBatch(omp_get_thread_num(), shardNum);
+			}
+		}
+		if(twoPass && !closeLowCountSpill(sNum)){
+			#pragma omp critical
+			success = false;
 		}
 	}
+	if(!success){
+		return false;
+	}
 	if(twoPass){
+		// Only counts of kmers already held are set, so shards need no locks
 		cout << "Second pass..." << endl;
+		buildQualifyingFilter();
+		#pragma omp parallel for schedule(dynamic) if(numShards > 1)
 		for(int sNum=0; sNum < numSamples; sNum++){
-			int fileType = testKmerFileForSample(sNum);
-			switch(fileType){
-				case 1:
-					if(!readTabCountsForSample(sNum, 2)){
-						cerr << "Failed to read kmers for " << labels[sNum] << " from tab file " << inFileNames[sNum] << endl;
-					}
-					break;
-				case 2:
-					if(!readFastaCountsForSample(sNum, 2)){
-						cerr << "Failed to read kmers for " << labels[sNum] << " from fasta file" << inFileNames[sNum] << endl;
-					}
-					break;
-				default:
-					cerr << "Failed to read kmers for " << labels[sNum] << " from file " << inFileNames[sNum] << endl;
+			if(!replayLowCounts(sNum)){
+				#pragma omp critical
+				success = false;
 			}
 		}
+		if(!success){
+			return false;
+		}
 	}
 
 	if(!writeOutput()){
@@ -113,10 +168,373 @@ bool KmerCountMerger::MergeKmerCounts(){
 }
 
 
-/*** Peek at format of input file for a specific sample (0=error,1=tab,2=fasta)
+/*** Read the input file for a specific sample, of either format
+**/
+bool KmerCountMerger::readKmerFileForSample(const int sNum){
+	string firstKmerSeq;
+	int fileType = testKmerFileForSample(sNum, firstKmerSeq);
+	switch(fileType){
+		case 1:
+			if(!readTabCountsForSample(sNum)){
+				cerr << "Failed to read kmers for " << labels[sNum] << " from tab file " << inFileNames[sNum] << endl;
+				return false;
+			}
+			break;
+		case 2:
+			if(!readFastaCountsForSample(sNum)){
+				cerr << "Failed to read kmers for " << labels[sNum] << " from fasta file" << inFileNames[sNum] << endl;
+				return false;
+			}
+			break;
+		case 3:
+			if(!readJellyfishCountsForSample(sNum)){
+				cerr << "Failed to read kmers for " << labels[sNum] << " from Jellyfish file " << inFileNames[sNum] << endl;
+				return false;
+			}
+			break;
+		default:
+			cerr << "Failed to read kmers for " << labels[sNum] << " from file " << inFileNames[sNum] << endl;
+			return false;
+	}
+	return true;
+}
+
+
+/*** Set kmerLen from the first encodable kmer of the inputs, before parsing in parallel
+**/
+void KmerCountMerger::setKmerLenFromInputs(){
+	for(int sNum=0; sNum < numSamples && kmerLen == 0; sNum++){
+		string firstKmerSeq;
+		uint64_t key;
+		if(testKmerFileForSample(sNum, firstKmerSeq) > 0 && KmerHashTable::encode(firstKmerSeq, key)){
+			kmerLen = firstKmerSeq.length();
+		}
+	}
+	kmerLenFixed = true;
+}
+
+
+/*** External mode merge
+** Each sample's kmers are sorted into runs on disk, in parallel over samples with memory per thread bounded.
+** Runs are then merged across all samples and rows written as they are completed, applying minCount
+** directly, so two-pass mode is not needed.
+**/
+bool KmerCountMerger::mergeKmerCountsExternal(){
+
+	setKmerLenFromInputs();
+	kmerRuns.init(tempDir, numSamples, kmerLen, canonical);
+	runBuffers.assign(numSamples, vector< KmerRecord >());
+	seqRunBuffers.assign(numSamples, vector< KmerSeqRecord >());
+	runBufferBytes.assign(numSamples, 0);
+	runBufferMaxBytes = max((size_t)1, maxMemBytes / omp_get_max_threads());
+	cout << "Sorting kmers to runs in " << tempDir << ", up to " << runBufferMaxBytes / (1024 * 1024) << "MB per thread" << endl;
+
+	bool success = true;
+	#pragma omp parallel for schedule(dynamic)
+	for(int sNum=0; sNum < numSamples; sNum++){
+		readKmerFileForSample(sNum);
+		if(!flushRunBuffers(sNum)){
+			#pragma omp critical
+			success = false;
+		}
+	}
+	if(!success || !kmerRuns.startMerge()){
+		kmerRuns.removeRuns();
+		return false;
+	}
+
+	if(!outtabfile.is_open()){
+		cerr << "Output file is not open for writing! Can't output results.\n";
+		kmerRuns.removeRuns();
+		return false;
+	}
+	outtabfile << "KmerSeq";
+	for(int sNum=0; sNum < numSamples; sNum++){
+		outtabfile << "\t" << labels[sNum];
+	}
+	outtabfile << "\n";
+
+	string kmerSeq;
+	vector< unsigned int > countsV;
+	unsigned int totKmers = 0;
+	while(kmerRuns.nextRow(kmerSeq, countsV)){
+		if(writeKmerRow(outtabfile, kmerSeq, &countsV[0])){
+			totKmers++;
+		}
+	}
+	kmerRuns.removeRuns();
+	outtabfile.close();
+	cout << "Wrote " << totKmers << " kmer seqs and counts to out file" << endl;
+	return true;
+}
+
+
+/*** External mode, write a sample's buffered kmers as sorted runs
+**/
+bool KmerCountMerger::flushRunBuffers(const int sNum){
+	bool success = kmerRuns.writeRun(sNum, runBuffers[sNum]);
+	success = kmerRuns.writeSeqRun(sNum, seqRunBuffers[sNum]) && success;
+	runBufferBytes[sNum] = 0;
+	return success;
+}
+
+
+/*** Add a kmer's count for a sample as read, returns true if kept
+**/
+bool KmerCountMerger::addKmerCount(const int sNum, const string& kmerSeq, const unsigned int kmerCount){
+
+	// Kmers of up to 32 ACGT bases, all of the same length, can be encoded
+	uint64_t key = 0;
+	const bool encoded = ((kmerLen == 0 && !kmerLenFixed) || kmerSeq.length() == kmerLen) && KmerHashTable::encode(kmerSeq, key);
+	if(encoded && kmerLen == 0 && !kmerLenFixed){
+		kmerLen = kmerSeq.length();
+	}
+	return addKmerCount(sNum, kmerSeq, encoded, key, kmerCount);
+}
+
+
+/*** Add a count for a sample of a kmer read already encoded, of length keyKmerLen, returns true if kept
+**/
+bool KmerCountMerger::addEncodedKmerCount(const int sNum, const uint64_t key, const int keyKmerLen, const unsigned int kmerCount){
+	if(kmerLen == 0 && !kmerLenFixed){
+		kmerLen = keyKmerLen;
+	}
+	if(keyKmerLen != kmerLen){
+		return addKmerCount(sNum, KmerHashTable::decode(key, keyKmerLen), kmerCount);
+	}
+	static const string noKmerSeq;
+	return addKmerCount(sNum, noKmerSeq, true, key, kmerCount);
+}
+
+
+/*** Add a kmer's count for a sample, as encoded key if encoded, else as kmerSeq.  Returns true if kept
+** Held in memory, or in external mode buffered for writing to a sorted run.
+** In two-pass mode counts below minCount are spilled for the second pass.
+**/
+bool KmerCountMerger::addKmerCount(const int sNum, const string& kmerSeq, const bool encoded, uint64_t key, const unsigned int kmerCount){
+
+	if(canonical){
+		if(encoded){
+			key = KmerHashTable::canonical(key, kmerLen);
+		}else{
+			// Others (rare) by sequence, in the same alphabetically first orientation
+			const string revKmerSeq = SeqReader::revComp(kmerSeq);
+			if(revKmerSeq < kmerSeq){
+				return addKmerCount(sNum, revKmerSeq, kmerCount);
+			}
+		}
+	}
+
+	if(tempDir != ""){
+		if(encoded){
+			KmerRecord record;
+			record.key = key;
+			record.count = kmerCount;
+			runBuffers[sNum].push_back(record);
+			runBufferBytes[sNum] += sizeof(KmerRecord);
+		}else{
+			seqRunBuffers[sNum].push_back(KmerSeqRecord());
+			seqRunBuffers[sNum].back().kmerSeq = kmerSeq;
+			seqRunBuffers[sNum].back().count = kmerCount;
+			runBufferBytes[sNum] += sizeof(KmerSeqRecord) + kmerSeq.length();
+		}
+		if(runBufferBytes[sNum] >= runBufferMaxBytes){
+			return flushRunBuffers(sNum);
+		}
+		return true;
+	}
+
+	KmerShard& shard = shards[getShard(kmerSeq, encoded, key)];
+
+	if(twoPass && kmerCount < firstPassMinCount){
+		spillLowCount(sNum, kmerSeq, encoded, key, kmerCount);
+		return false;
+	}
+
+	if(shards.size() == 1){
+		setSampleCount(getKmerCounts(shard, kmerSeq, encoded, key, true), sNum, kmerCount);
+	}else if(encoded){
+		// Sharded mode, batch kmers to take each shard's lock less often
+		const int threadNum = omp_get_thread_num();
+		const int shardNum = &shard - &shards[0];
+		ShardRecord record;
+		record.key = key;
+		record.count = kmerCount;
+		record.sNum = sNum;
+		shardBatches[threadNum][shardNum].push_back(record);
+		if(shardBatches[threadNum][shardNum].size() >= shardBatchSize){
+			flushShardBatch(threadNum, shardNum);
+		}
+	}else{
+		omp_set_lock(&shard.lock);
+		setSampleCount(getKmerCounts(shard, kmerSeq, encoded, key, true), sNum, kmerCount);
+		omp_unset_lock(&shard.lock);
+	}
+	return true;
+}
+
+
+/*** Set a sample's count for a kmer, or in canonical mode add to it
+** In canonical mode a sample may list both orientations of a kmer, both counting towards it
+**/
+void KmerCountMerger::setSampleCount(unsigned int* countsV, const int sNum, const unsigned int kmerCount) const{
+	if(canonical){
+		countsV[sNum] += kmerCount;
+	}else{
+		countsV[sNum] = kmerCount;
+	}
+}
+
+
+/*** Two-pass mode, open temp files for a sample's low count kmers
+** Named after the output file, so as to sit alongside it
+**/
+bool KmerCountMerger::openLowCountSpill(const int sNum){
+	LowCountSpill* spill = new LowCountSpill();
+	lowCountSpills[sNum] = spill;
+	stringstream fileNameSS;
+	fileNameSS << outTabFileName << ".lowcounts" << sNum;
+	spill->keyFileName = fileNameSS.str() + ".bin";
+	spill->seqFileName = fileNameSS.str() + ".seqs.bin";
+	spill->keyFile.open(spill->keyFileName.c_str(), ios_base::out | ios_base::binary);
+	spill->seqFile.open(spill->seqFileName.c_str(), ios_base::out | ios_base::binary);
+	if(!spill->keyFile.is_open() || !spill->seqFile.is_open()){
+		cerr << "Unable to open temp file " << spill->keyFileName << "!\n";
+		return false;
+	}
+	spill->keyBuffer.reserve(spillBufferBytes);
+	return true;
+}
+
+
+/*** Two-pass mode, keep a low count kmer for the second pass
+**/
+void KmerCountMerger::spillLowCount(const int sNum, const string& kmerSeq, const bool encoded, const uint64_t key, const unsigned int kmerCount){
+	LowCountSpill& spill = *lowCountSpills[sNum];
+	if(encoded){
+		const char* keyBytes = (const char*)&key;
+		const char* countBytes = (const char*)&kmerCount;
+		spill.keyBuffer.insert(spill.keyBuffer.end(), keyBytes, keyBytes + sizeof(key));
+		spill.keyBuffer.insert(spill.keyBuffer.end(), countBytes, countBytes + sizeof(kmerCount));
+		if(spill.keyBuffer.size() >= spillBufferBytes){
+			spill.keyFile.write(&spill.keyBuffer[0], spill.keyBuffer.size());
+			spill.keyBuffer.clear();
+		}
+	}else{
+		const uint32_t seqLen = kmerSeq.length();
+		spill.seqFile.write((const char*)&seqLen, sizeof(seqLen));
+		spill.seqFile.write(kmerSeq.data(), seqLen);
+		spill.seqFile.write((const char*)&kmerCount, sizeof(kmerCount));
+	}
+}
+
+
+/*** Two-pass mode, finish writing a sample's low count kmers
+**/
+bool KmerCountMerger::closeLowCountSpill(const int sNum){
+	LowCountSpill& spill = *lowCountSpills[sNum];
+	if(!spill.keyBuffer.empty()){
+		spill.keyFile.write(&spill.keyBuffer[0], spill.keyBuffer.size());
+	}
+	vector< char >().swap(spill.keyBuffer);
+	spill.keyFile.close();
+	spill.seqFile.close();
+	if(!spill.keyFile || !spill.seqFile){
+		cerr << "Unable to write temp file " << spill.keyFileName << "!\n";
+		return false;
+	}
+	return true;
+}
+
+
+/*** Two-pass mode, fill qualifyingFilter from all encoded kmers held
+**/
+void KmerCountMerger::buildQualifyingFilter(){
+	size_t numKmers = 0;
+	for(int shardNum=0; shardNum < shards.size(); shardNum++){
+		numKmers += shards[shardNum].table.size();
+	}
+	qualifyingFilter.init(numKmers);
+	vector< uint64_t > keys;
+	for(int shardNum=0; shardNum < shards.size(); shardNum++){
+		shards[shardNum].table.sortedKeys(keys);
+		for(size_t i=0; i < keys.size(); i++){
+			qualifyingFilter.add(keys[i]);
+		}
+	}
+}
+
+
+/*** Two-pass mode, second pass: add a sample's low counts for kmers held, then delete its temp files
+** Encoded kmers are checked against qualifyingFilter first, ruling out most without probing a table.
+**/
+bool KmerCountMerger::replayLowCounts(const int sNum){
+	LowCountSpill& spill = *lowCountSpills[sNum];
+	const size_t recordBytes = sizeof(uint64_t) + sizeof(unsigned int);
+	unsigned int totKmers = 0;
+	bool success = true;
+
+	ifstream keyFile(spill.keyFileName.c_str(), ios_base::in | ios_base::binary);
+	vector< char > buffer(spillBufferBytes - spillBufferBytes % recordBytes);
+	string kmerSeq;
+	while(keyFile.read(&buffer[0], buffer.size()) || keyFile.gcount() > 0){
+		const size_t bufferBytes = keyFile.gcount() - keyFile.gcount() % recordBytes;
+		for(size_t pos=0; pos < bufferBytes; pos += recordBytes){
+			uint64_t key;
+			unsigned int kmerCount;
+			memcpy(&key, &buffer[pos], sizeof(key));
+			memcpy(&kmerCount, &buffer[pos + sizeof(key)], sizeof(kmerCount));
+			if(!qualifyingFilter.mayContain(key)){
+				continue;
+			}
+			unsigned int* countsV = shards[getShard(kmerSeq, true, key)].table.find(key);
+			if(countsV != NULL){
+				setSampleCount(countsV, sNum, kmerCount);
+				totKmers++;
+			}
+		}
+	}
+	keyFile.close();
+
+	ifstream seqFile(spill.seqFileName.c_str(), ios_base::in | ios_base::binary);
+	uint32_t seqLen;
+	while(seqFile.read((char*)&seqLen, sizeof(seqLen))){
+		unsigned int kmerCount;
+		kmerSeq.resize(seqLen);
+		seqFile.read(&kmerSeq[0], seqLen);
+		if(!seqFile.read((char*)&kmerCount, sizeof(kmerCount))){
+			cerr << "Temp file " << spill.seqFileName << " is truncated!\n";
+			success = false;
+			break;
+		}
+		KmerShard& shard = shards[getShard(kmerSeq, false, 0)];
+		unsigned int* countsV = getKmerCounts(shard, kmerSeq, false, 0, false);
+		if(countsV != NULL){
+			setSampleCount(countsV, sNum, kmerCount);
+			totKmers++;
+		}
+	}
+	seqFile.close();
+
+	remove(spill.keyFileName.c_str());
+	remove(spill.seqFileName.c_str());
+	delete lowCountSpills[sNum];
+	lowCountSpills[sNum] = NULL;
+	cout << "Added " << totKmers << " low kmer counts for " << labels[sNum] << endl;
+	return success;
+}
+
+
+/*** Peek at format of input file for a specific sample (0=error,1=tab,2=fasta,3=Jellyfish), and get its first kmer
 **/
-int KmerCountMerger::testKmerFileForSample(const int sNum){
+int KmerCountMerger::testKmerFileForSample(const int sNum, string& firstKmerSeq){
 
+	// Each file is only opened to test once
+	if(fileTypes[sNum] >= 0){
+		firstKmerSeq = firstKmerSeqs[sNum];
+		return fileTypes[sNum];
+	}
+	fileTypes[sNum] = 0;
 	int fileType = 0;
 	bool gzipFile = false;
 	ifstream fileifs;
@@ -148,10 +566,27 @@ int KmerCountMerger::testKmerFileForSample(const int sNum){
 		getline(infile, line);
 		if(line.find('>') == 0){
 			fileType = 2;
+			getline(infile, firstKmerSeq);
 		}else if(line.find('\t') > 0 && line.find('\t') != std::string::npos){
 			fileType = 1;
+			firstKmerSeq = line.substr(0, line.find('\t'));
+		}else if(!gzipFile && line.length() > 9 && line.find_first_not_of("0123456789") == 9 && line[9] == '{'){
+			// Jellyfish database, get first kmer from its first record
+			fileifs.close();
+			fileifs.clear();
+			fileifs.open(filename.c_str(), ios_base::in | ios_base::binary);
+			int keyBytes, valBytes, jfKmerLen;
+			if(readJellyfishHeader(fileifs, keyBytes, valBytes, jfKmerLen)){
+				fileType = 3;
+				vector< char > record(keyBytes + valBytes);
+				if(fileifs.read(&record[0], record.size())){
+					firstKmerSeq = KmerHashTable::decode(jellyfishRecordValue(&record[0], keyBytes), jfKmerLen);
+				}
+			}
 		}
 		fileifs.close();
+		fileTypes[sNum] = fileType;
+		firstKmerSeqs[sNum] = firstKmerSeq;
 	}
 	catch(const gzip_error& e) {
 		cerr << "Error while reading file " << filename << endl;
@@ -165,7 +600,7 @@ int KmerCountMerger::testKmerFileForSample(const int sNum){
 
 /*** Read the input file for a specific sample - tab format 
 **/
-bool KmerCountMerger::readTabCountsForSample(const int sNum, const int pass){
+bool KmerCountMerger::readTabCountsForSample(const int sNum){
 	ifstream fileifs;
 	bool gzipFile = false;
 	string filename = inFileNames[sNum];
@@ -212,18 +647,8 @@ bool KmerCountMerger::readTabCountsForSample(const int sNum, const int pass){
 				stringstream valuess(lineParts[1]);
 				valuess >> kmerCount;
 
-				if( (twoPass && pass == 1 && kmerCount >= minCount) || !twoPass ){
+				if(addKmerCount(sNum, kmerSeq, kmerCount)){
 					totKmers++;
-					if(kmerCounts.count(kmerSeq) == 0){
-						kmerCounts[kmerSeq] = vector< unsigned int >(numSamples, 0);
-					}
-					kmerCounts[kmerSeq][sNum] = kmerCount;
-				}else if(twoPass && pass == 2 && kmerCount < minCount){
-					// Second pass, add sample count if found with minCount in another sample
-					if(kmerCounts.count(kmerSeq) == 1){
-						totKmers++;
-						kmerCounts[kmerSeq][sNum] = kmerCount;
-					}
 				}
 			}
 		}
@@ -240,48 +665,230 @@ bool KmerCountMerger::readTabCountsForSample(const int sNum, const int pass){
 }
 
 
+/*** Read the header of a Jellyfish database, leaving infile at its first record.  Returns false if not a supported format
+** Header is its length as 9 decimal digits then JSON.  Supports the binary/sorted layout written by jellyfish count/merge,
+** where each record is the 2-bit kmer (key_len bits, first base most significant) then count (val_len bytes), little-endian.
+**/
+bool KmerCountMerger::readJellyfishHeader(istream& infile, int& keyBytes, int& valBytes, int& jfKmerLen){
+	char lengthChars[10] = {0};
+	if(!infile.read(lengthChars, 9)){
+		return false;
+	}
+	const size_t headerLen = strtoul(lengthChars, NULL, 10);
+	string header(headerLen, ' ');
+	if(headerLen == 0 || !infile.read(&header[0], headerLen)){
+		cerr << "Jellyfish header is truncated!\n";
+		return false;
+	}
+	if(header.find("\"binary/sorted\"") == string::npos){
+		cerr << "Jellyfish file is not in binary format (only binary/sorted is supported)!\n";
+		return false;
+	}
+	const long keyLenBits = getJsonNumber(header, "key_len");
+	valBytes = getJsonNumber(header, "val_len");
+	if(keyLenBits < 2 || keyLenBits > 64 || keyLenBits % 2 != 0 || valBytes < 1 || valBytes > 8){
+		cerr << "Jellyfish file has unsupported key_len/val_len (kmers of up to 32 bases are supported)!\n";
+		return false;
+	}
+	jfKmerLen = keyLenBits / 2;
+	keyBytes = (keyLenBits + 7) / 8;
+	return true;
+}
+
+
+/*** Value of a numeric field in a JSON object, or -1 if not found
+** Only a simple search, enough for the flat fields of a Jellyfish header
+**/
+long KmerCountMerger::getJsonNumber(const string& json, const string& fieldName){
+	size_t pos = json.find("\"" + fieldName + "\"");
+	if(pos == string::npos){
+		return -1;
+	}
+	pos = json.find(':', pos);
+	if(pos == string::npos){
+		return -1;
+	}
+	return strtol(json.c_str() + pos + 1, NULL, 10);
+}
+
+
+/*** Unsigned little-endian value of numBytes bytes
+**/
+uint64_t KmerCountMerger::jellyfishRecordValue(const char* bytes, const int numBytes){
+	uint64_t value = 0;
+	for(int i = numBytes - 1; i >= 0; i--){
+		value = (value << 8) | (unsigned char)bytes[i];
+	}
+	return value;
+}
+
+
+/*** Read the input file for a specific sample - Jellyfish binary database
+** Kmers are taken as encoded keys, without conversion to text
+**/
+bool KmerCountMerger::readJellyfishCountsForSample(const int sNum){
+	string filename = inFileNames[sNum];
+	ifstream infile(filename.c_str(), ios_base::in | ios_base::binary);
+	if(!infile.is_open()){
+		cerr << "Unable to open file " << filename << "!\n";
+		return false;
+	}
+	int keyBytes, valBytes, jfKmerLen;
+	if(!readJellyfishHeader(infile, keyBytes, valBytes, jfKmerLen)){
+		infile.close();
+		return false;
+	}
+	cout << "Parsing kmer counts from " << filename << endl;
+
+	const uint64_t keyMask = (jfKmerLen == 32) ? ~0ULL : ((1ULL << (2 * jfKmerLen)) - 1);
+	const int recordBytes = keyBytes + valBytes;
+	vector< char > buffer(recordBytes * jellyfishBufferRecords);
+	unsigned int totKmers = 0;
+	while(infile.read(&buffer[0], buffer.size()) || infile.gcount() > 0){
+		const size_t bufferBytes = infile.gcount() - infile.gcount() % recordBytes;
+		for(size_t pos=0; pos < bufferBytes; pos += recordBytes){
+			const uint64_t key = jellyfishRecordValue(&buffer[pos], keyBytes) & keyMask;
+			const uint64_t count = jellyfishRecordValue(&buffer[pos + keyBytes], valBytes);
+			const unsigned int kmerCount = (count > UINT_MAX) ? UINT_MAX : count;
+			if(addEncodedKmerCount(sNum, key, jfKmerLen, kmerCount)){
+				totKmers++;
+			}
+		}
+	}
+	infile.close();
+	cout << "Loaded " << totKmers << " kmer seqs and counts from " << filename << endl;
+	return true;
+}
+
+
 /*** Read the input file for a specific sample - FASTA format 
+** Lines are scanned in place from large blocks, the count parsed straight from the header and bases
+** gathered into one reused string (a kmer may be over several lines) to be encoded
 **/
-bool KmerCountMerger::readFastaCountsForSample(const int sNum, const int pass){
+bool KmerCountMerger::readFastaCountsForSample(const int sNum){
+	ifstream fileifs;
+	bool gzipFile = false;
 	string filename = inFileNames[sNum];
+	if(filename.find("gz", filename.length()-3) != string::npos || 
+			filename.find("GZ", filename.length()-3) != string::npos){
+		gzipFile = true;
+	}
+	fileifs.open(filename.c_str(), ios_base::in | ios_base::binary);
+	if (!fileifs.is_open()){
+		cerr << "Unable to open file " << filename << "!\n";
+		return false;
+	}else if (!fileifs.good()){
+		cerr << "File " << filename << " is empty!\n";
+		fileifs.close();
+		return false;
+	}
 	try {
-		SeqReader inFile(filename);
-		unsigned int totKmers = 0;
+		filtering_istream infile;
+		if(gzipFile){
+			infile.push(gzip_decompressor());
+		}
+		infile.push(fileifs);
 		cout << "Parsing kmer counts from " << filename << endl;
-		while(inFile.nextSeq()){
-			unsigned int kmerCount;
-			stringstream valuess(inFile.getSeqID());
-			valuess >> kmerCount;
-			if(inFile.getSeqLen() > 0){
-				totKmers++;
-				string kmerSeq = inFile.getSeq();
-				if( (twoPass && pass == 1 && kmerCount >= minCount) || !twoPass ){
+
+		LineScanner scanner(infile);
+		const char* line;
+		size_t lineLen;
+		string kmerSeq;
+		kmerSeq.reserve(64);
+		unsigned int kmerCount = 0;
+		unsigned int totKmers = 0;
+		bool inRecord = false;
+		while(scanner.nextLine(line, lineLen)){
+			if(lineLen == 0){
+				continue;
+			}
+			if(line[0] == '>'){
+				if(inRecord && kmerSeq.length() > 0 && addKmerCount(sNum, kmerSeq, kmerCount)){
 					totKmers++;
-					if(kmerCounts.count(kmerSeq) == 0){
-						kmerCounts[kmerSeq] = vector< unsigned int >(numSamples, 0);
-					}
-					kmerCounts[kmerSeq][sNum] = kmerCount;
-				}else if(twoPass && pass == 2 && kmerCount < minCount){
-					// Second pass, add sample count if found with minCount in another sample
-					if(kmerCounts.count(kmerSeq) == 1){
-						totKmers++;
-						kmerCounts[kmerSeq][sNum] = kmerCount;
-					}
 				}
+				// Seq ID is the count
+				kmerCount = LineScanner::parseUInt(line + 1, line + lineLen);
+				kmerSeq.clear();
+				inRecord = true;
+			}else if(inRecord){
+				kmerSeq.append(line, lineLen);
 			}
 		}
+		if(inRecord && kmerSeq.length() > 0 && addKmerCount(sNum, kmerSeq, kmerCount)){
+			totKmers++;
+		}
+		fileifs.close();
 		cout << "Loaded " << totKmers << " kmer seqs and counts from " << filename << endl;
 	}
 	catch(const gzip_error& e) {
 		cerr << "Error while reading file " << filename << endl;
 		cerr << e.what() << endl;
+		fileifs.close();
 		return false;
 	}
 	return true;
 }
 
 
+/*** Counts per sample for a kmer in a shard, adding it if not held and addIfMissing, else NULL if not held
+** Encoded kmers go in the shard's hash table, any others in its map.
+**/
+unsigned int* KmerCountMerger::getKmerCounts(KmerShard& shard, const string& kmerSeq, const bool encoded, const uint64_t key, const bool addIfMissing){
+	if(encoded){
+		if(addIfMissing){
+			return shard.table.insert(key);
+		}
+		return shard.table.find(key);
+	}
+	KmerCountMap::iterator aKmer = shard.seqCounts.find(kmerSeq);
+	if(aKmer != shard.seqCounts.end()){
+		return &aKmer->second[0];
+	}else if(addIfMissing){
+		vector< unsigned int >& countsV = shard.seqCounts[kmerSeq];
+		countsV.assign(numSamples, 0);
+		return &countsV[0];
+	}
+	return NULL;
+}
+
+
+/*** Sharded mode, shard holding a kmer, by its leading bases
+** Kmers that can't be encoded go to the shard whose range of kmers they sort into.
+**/
+int KmerCountMerger::getShard(const string& kmerSeq, const bool encoded, const uint64_t key){
+	if(shards.size() == 1){
+		return 0;
+	}
+	if(encoded && kmerLen >= shardBases){
+		return (key >> (2 * (kmerLen - shardBases)));
+	}else if(encoded){
+		// Kmers shorter than the shard prefix sort just before the kmers they start
+		return (key << (2 * (shardBases - kmerLen)));
+	}
+	int shardNum = upper_bound(shardPrefixes.begin(), shardPrefixes.end(), kmerSeq) - shardPrefixes.begin() - 1;
+	return max(0, shardNum);
+}
+
+
+/*** Sharded mode, add a thread's batched kmers to a shard
+**/
+void KmerCountMerger::flushShardBatch(const int threadNum, const int shardNum){
+	vector< ShardRecord >& batch = shardBatches[threadNum][shardNum];
+	if(batch.empty()){
+		return;
+	}
+	KmerShard& shard = shards[shardNum];
+	omp_set_lock(&shard.lock);
+	for(int i=0; i < batch.size(); i++){
+		setSampleCount(shard.table.insert(batch[i].key), batch[i].sNum, batch[i].count);
+	}
+	omp_unset_lock(&shard.lock);
+	batch.clear();
+}
+
+
 /*** Finalise results to file
+** In sharded mode each shard is written to its own temp file in parallel, then concatenated in order.
 **/
 bool KmerCountMerger::writeOutput(){
 
@@ -296,30 +903,100 @@ bool KmerCountMerger::writeOutput(){
 	}
 	outtabfile << "\n";
 
+	const int numShards = shards.size();
 	unsigned int totKmers = 0;
-	for(KmerCountMap::iterator aKmer=kmerCounts.begin(); aKmer!=kmerCounts.end(); ++aKmer){
-		string kmerSeq = aKmer->first;
-		vector< unsigned int > countsV = aKmer->second;
-
-		// Check if minimum count met for printing
-		bool doPrint = false;
-		for(int sNum=0; sNum < numSamples && !doPrint; sNum++){
-			if(countsV[sNum] >= minCount){
-				doPrint = true;
+	if(numShards == 1){
+		totKmers = writeShard(0, outtabfile);
+	}else{
+		bool success = true;
+		#pragma omp parallel for schedule(dynamic) reduction(+:totKmers)
+		for(int shardNum=0; shardNum < numShards; shardNum++){
+			stringstream shardFileName;
+			shardFileName << outTabFileName << ".shard" << shardNum;
+			ofstream shardFile(shardFileName.str().c_str());
+			totKmers += writeShard(shardNum, shardFile);
+			shardFile.close();
+			if(!shardFile){
+				#pragma omp critical
+				success = false;
 			}
 		}
-
-		// Output for a kmer
-		if(doPrint){
-			totKmers++;
-			outtabfile << kmerSeq;
-			for(int sNum=0; sNum < numSamples; sNum++){
-				outtabfile << "\t" << countsV[sNum];
+		for(int shardNum=0; shardNum < numShards; shardNum++){
+			stringstream shardFileName;
+			shardFileName << outTabFileName << ".shard" << shardNum;
+			ifstream shardFile(shardFileName.str().c_str());
+			if(shardFile.peek() != EOF){
+				outtabfile << shardFile.rdbuf();
 			}
-			outtabfile << "\n";
+			shardFile.close();
+			remove(shardFileName.str().c_str());
+		}
+		if(!success){
+			cerr << "Failed writing shard output files alongside " << outTabFileName << "!\n";
+			outtabfile.close();
+			return false;
 		}
 	}
 	outtabfile.close();
 	cout << "Wrote " << totKmers << " kmer seqs and counts to out file" << endl;
+	return true;
+}
+
+
+/*** Write a shard's kmers and counts in alphabetical order, returns number written
+** Table kmers in sorted key order, merged with any others held by string to keep alphabetical order
+**/
+unsigned int KmerCountMerger::writeShard(const int shardNum, ostream& out){
+
+	KmerShard& shard = shards[shardNum];
+	vector< uint64_t > sortedKeys;
+	shard.table.sortedKeys(sortedKeys);
+	size_t keyI = 0;
+	string tableKmerSeq;
+	if(keyI < sortedKeys.size()){
+		tableKmerSeq = KmerHashTable::decode(sortedKeys[keyI], kmerLen);
+	}
+	KmerCountMap::iterator aKmer = shard.seqCounts.begin();
+	unsigned int totKmers = 0;
+	while(keyI < sortedKeys.size() || aKmer != shard.seqCounts.end()){
+		if(aKmer == shard.seqCounts.end() || (keyI < sortedKeys.size() && tableKmerSeq < aKmer->first)){
+			if(writeKmerRow(out, tableKmerSeq, shard.table.find(sortedKeys[keyI]))){
+				totKmers++;
+			}
+			keyI++;
+			if(keyI < sortedKeys.size()){
+				tableKmerSeq = KmerHashTable::decode(sortedKeys[keyI], kmerLen);
+			}
+		}else{
+			if(writeKmerRow(out, aKmer->first, &aKmer->second[0])){
+				totKmers++;
+			}
+			++aKmer;
+		}
+	}
+	return totKmers;
 }
 
+
+/*** Write a kmer's counts if minimum count met, returns true if written
+**/
+bool KmerCountMerger::writeKmerRow(ostream& out, const string& kmerSeq, const unsigned int* countsV){
+
+	// Check if minimum count met for printing
+	bool doPrint = false;
+	for(int sNum=0; sNum < numSamples && !doPrint; sNum++){
+		if(countsV[sNum] >= minCount){
+			doPrint = true;
+		}
+	}
+
+	// Output for a kmer
+	if(doPrint){
+		out << kmerSeq;
+		for(int sNum=0; sNum < numSamples; sNum++){
+			out << "\t" << countsV[sNum];
+		}
+		out << "\n";
+	}
+	return doPrint;
+}
@@ -1,6 +1,7 @@
 #ifndef KMERTALLYER_H
 #define KMERTALLYER_H
 
+#include <omp.h>
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -9,11 +10,16 @@
 #include <string>
 #include <cstring>
 #include <ctype.h>
+#include <climits>
 #include <sstream>
 #include <algorithm>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include "SeqReader.h"
+#include "KmerHashTable.h"
+#include "KmerRunSet.h"
+#include "KmerBloomFilter.h"
+#include "LineScanner.h"
 using namespace std;
 
 /* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
@@ -22,33 +28,120 @@ using namespace std;
 
 typedef map< string, vector< unsigned int > > KmerCountMap; //!< kmer seq, read counts per kmer seq per sample
 
+struct KmerShard {
+	KmerHashTable table; //!< Read counts per sample for kmers of kmerLen ACGT bases, 2-bit encoded
+	KmerCountMap seqCounts; //!< Read counts per sample for kmers that can't be encoded in table
+	omp_lock_t lock; //!< Sharded mode, held while adding kmers
+}; //!< Kmers starting with one range of leading bases
+
+struct ShardRecord {
+	uint64_t key;
+	unsigned int count;
+	int sNum;
+}; //!< Encoded kmer count for a sample, waiting to be added to its shard
+
+struct LowCountSpill {
+	string keyFileName;
+	string seqFileName;
+	ofstream keyFile; //!< Encoded kmers, packed as 8-byte key then 4-byte count
+	ofstream seqFile; //!< Other kmers, as length (4 bytes), kmer seq, count (4 bytes)
+	vector< char > keyBuffer; //!< Packed encoded kmers not yet written
+}; //!< Two-pass mode, one sample's kmers below minCount, kept from the first pass for the second
+
 class KmerCountMerger {
   private:
   	int minCount; //!< Minimum reads seen in any one sample to make it worth printing results for a kmer
 	bool twoPass; //!< Two-pass mode on/off
+	int firstPassMinCount; //!< Two-pass mode, count of one record for its kmer to be held in the first pass
+	bool canonical; //!< Canonical mode on/off: each kmer is merged with its reverse complement, counts of both added
+	string tempDir; //!< External mode, directory for sorted runs of kmers; external mode is off if blank
+	size_t maxMemBytes; //!< External mode, memory for kmers held before sorting and writing a run, shared between threads
 	vector<string> inFileNames; //!< List of kmer-count tab-sep/fasta files for input
 	vector<string> labels;  //!< List of sample names, one for each corresponding input file
 	int numSamples; //!< Number of input samples == number of tab file inputs
 	ofstream outtabfile; //!< Tabular output file name
 	bool prepRan;  //!< Indicates that class has been initialised, output files have been opened and processing is ready to run
 	
-	KmerCountMap kmerCounts; //!< Read counts per kmer seq per sample
+	string outTabFileName; //!< Tabular output file name
+	int kmerLen; //!< Length of kmers held encoded, set by the first one encoded
+	bool kmerLenFixed; //!< kmerLen set from inputs before parsing, for parallel modes
+	vector< KmerShard > shards; //!< Read counts per kmer per sample, in shards by leading bases (a single shard unless sharded mode)
+	int shardBases; //!< Sharded mode, number of leading bases deciding a kmer's shard
+	vector< string > shardPrefixes; //!< Sharded mode, first kmer of each shard, for kmers that can't be encoded
+	vector< vector< vector< ShardRecord > > > shardBatches; //!< Sharded mode, kmers waiting to be added, per thread per shard
+	static const int shardBatchSize = 256; //!< Sharded mode, kmers batched per shard before taking its lock
+	static const int maxShardBases = 6; //!< Sharded mode, up to 4^6 shards
+	KmerRunSet kmerRuns; //!< External mode, sorted runs of each sample's kmers on disk
+	vector< vector< KmerRecord > > runBuffers; //!< External mode, encoded kmers per sample not yet written to a run
+	vector< vector< KmerSeqRecord > > seqRunBuffers; //!< External mode, other kmers per sample not yet written to a run
+	vector< size_t > runBufferBytes; //!< External mode, approx memory held per sample in run buffers
+	size_t runBufferMaxBytes; //!< External mode, memory per thread before a run is written
+	vector< int > fileTypes; //!< Format of each input file (0=error,1=tab,2=fasta,3=Jellyfish), -1 until tested
+	vector< string > firstKmerSeqs; //!< First kmer of each input file, once tested
+	vector< LowCountSpill* > lowCountSpills; //!< Two-pass mode, low count kmers per sample
+	KmerBloomFilter qualifyingFilter; //!< Two-pass mode, encoded kmers with minCount in some sample
+	static const size_t spillBufferBytes = 1048576; //!< Two-pass mode, packed kmers buffered per sample before writing
+	static const int jellyfishBufferRecords = 65536; //!< Records read at a time from Jellyfish files
 	
 		/*** Actual constructor code, called by constructor forms **/
-	void prepareKmerCountMerger(const vector<string>& aLabelsList, const vector<string>& aFileNamesList, const string& aOutTabFileName, const int& aMinCount, const bool& aTwoPassSet);
-		/*** Peek at format of input file for a specific sample (0=error,1=tab,2=fasta) **/
-	int testKmerFileForSample(const int sNum);
+	void prepareKmerCountMerger(const vector<string>& aLabelsList, const vector<string>& aFileNamesList, const string& aOutTabFileName, const int& aMinCount, const bool& aTwoPassSet, const string& aTempDir, const int& aMaxMemMB, const int& aNumShards, const bool& aCanonical);
+		/*** Read the input file for a specific sample, of either format **/
+	bool readKmerFileForSample(const int sNum);
+		/*** Set kmerLen from the first encodable kmer of the inputs **/
+	void setKmerLenFromInputs();
+		/*** External mode merge, sorting each sample's kmers to runs on disk in parallel then merging runs **/
+	bool mergeKmerCountsExternal();
+		/*** Peek at format of input file for a specific sample (0=error,1=tab,2=fasta,3=Jellyfish), and get its first kmer **/
+	int testKmerFileForSample(const int sNum, string& firstKmerSeq);
+		/*** Add a kmer's count for a sample as read, returns true if kept **/
+	bool addKmerCount(const int sNum, const string& kmerSeq, const unsigned int kmerCount);
+		/*** Add a count for a sample of a kmer read already encoded, of length keyKmerLen, returns true if kept **/
+	bool addEncodedKmerCount(const int sNum, const uint64_t key, const int keyKmerLen, const unsigned int kmerCount);
+		/*** Add a kmer's count for a sample, as encoded key if encoded, else as kmerSeq.  Returns true if kept **/
+	bool addKmerCount(const int sNum, const string& kmerSeq, const bool encoded, uint64_t key, const unsigned int kmerCount);
+		/*** External mode, write a sample's buffered kmers as sorted runs **/
+	bool flushRunBuffers(const int sNum);
 		/*** Read the input file for a specific sample - tab format **/
-	bool readTabCountsForSample(const int sNum, const int pass);
+	bool readTabCountsForSample(const int sNum);
 		/*** Read the input file for a specific sample - FASTA format **/
-	bool readFastaCountsForSample(const int sNum, const int pass);
+	bool readFastaCountsForSample(const int sNum);
+		/*** Read the input file for a specific sample - Jellyfish binary database **/
+	bool readJellyfishCountsForSample(const int sNum);
+		/*** Read the header of a Jellyfish database, leaving infile at its first record.  Returns false if not a supported format **/
+	static bool readJellyfishHeader(istream& infile, int& keyBytes, int& valBytes, int& jfKmerLen);
+		/*** Value of a numeric field in a JSON object, or -1 if not found **/
+	static long getJsonNumber(const string& json, const string& fieldName);
+		/*** Unsigned little-endian value of numBytes bytes **/
+	static uint64_t jellyfishRecordValue(const char* bytes, const int numBytes);
+		/*** Set a sample's count for a kmer, or in canonical mode add to it **/
+	void setSampleCount(unsigned int* countsV, const int sNum, const unsigned int kmerCount) const;
+		/*** Two-pass mode, open temp files for a sample's low count kmers **/
+	bool openLowCountSpill(const int sNum);
+		/*** Two-pass mode, keep a low count kmer for the second pass **/
+	void spillLowCount(const int sNum, const string& kmerSeq, const bool encoded, const uint64_t key, const unsigned int kmerCount);
+		/*** Two-pass mode, finish writing a sample's low count kmers **/
+	bool closeLowCountSpill(const int sNum);
+		/*** Two-pass mode, fill qualifyingFilter from all encoded kmers held **/
+	void buildQualifyingFilter();
+		/*** Two-pass mode, second pass: add a sample's low counts for kmers held, then delete its temp files **/
+	bool replayLowCounts(const int sNum);
+		/*** Counts per sample for a kmer in a shard, adding it if not held and addIfMissing, else NULL if not held **/
+	unsigned int* getKmerCounts(KmerShard& shard, const string& kmerSeq, const bool encoded, const uint64_t key, const bool addIfMissing);
+		/*** Sharded mode, shard holding a kmer **/
+	int getShard(const string& kmerSeq, const bool encoded, const uint64_t key);
+		/*** Sharded mode, add a thread's batched kmers to a shard **/
+	void flushShardBatch(const int threadNum, const int shardNum);
+		/*** Write a shard's kmers and counts in alphabetical order, returns number written **/
+	unsigned int writeShard(const int shardNum, ostream& out);
+		/*** Write a kmer's counts if minimum count met, returns true if written **/
+	bool writeKmerRow(ostream& out, const string& kmerSeq, const unsigned int* countsV);
 		/*** Finalise results to file **/
 	bool writeOutput();
 
   public:
 		/** Initialise with no defaults **/
 	KmerCountMerger(const vector<string>& aLabelsList, const vector<string>& aFileNamesList, const string& aOutTabFileName);
-	KmerCountMerger(const vector<string>& aLabelsList, const vector<string>& aFileNamesList, const string& aOutTabFileName, const int& aMinCount, const bool& aTwoPassSet);
+	KmerCountMerger(const vector<string>& aLabelsList, const vector<string>& aFileNamesList, const string& aOutTabFileName, const int& aMinCount, const bool& aTwoPassSet, const string& aTempDir, const int& aMaxMemMB, const int& aNumShards, const bool& aCanonical);
 	~KmerCountMerger();
 	
 		/** Launch the full kmer count merging process **/
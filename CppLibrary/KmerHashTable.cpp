@@ -0,0 +1,201 @@
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdint.h>
+#include "KmerHashTable.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+const uint64_t KmerHashTable::emptyKey;
+
+KmerHashTable::KmerHashTable(){
+	init(1);
+}
+
+/*** Empty the table, ready for k-mers with this many counts each
+**/
+void KmerHashTable::init(int aNumSamples){
+	numSamples = aNumSamples;
+	numKmers = 0;
+	hasEmptyKeyKmer = false;
+	emptyKeyCounts.assign(numSamples, 0);
+	keys.assign(1024, emptyKey);
+	counts.assign(1024 * (size_t)numSamples, 0);
+	slotMask = 1023;
+}
+
+/*** Encode a k-mer of up to 32 upper-case ACGT bases as a key.  Returns false if it can't be encoded
+**/
+bool KmerHashTable::encode(const string& kmerSeq, uint64_t& key){
+	return encode(kmerSeq.data(), kmerSeq.length(), key);
+}
+
+bool KmerHashTable::encode(const char* kmerSeq, int kmerLen, uint64_t& key){
+	if(kmerLen < 1 || kmerLen > 32){
+		return false;
+	}
+	key = 0;
+	for(int i=0; i < kmerLen; i++){
+		uint64_t code;
+		switch(kmerSeq[i]){
+			case 'A':
+				code = 0;
+				break;
+			case 'C':
+				code = 1;
+				break;
+			case 'G':
+				code = 2;
+				break;
+			case 'T':
+				code = 3;
+				break;
+			default:
+				return false;
+		}
+		key = (key << 2) | code;
+	}
+	return true;
+}
+
+/*** Decode a key back to its k-mer sequence
+**/
+string KmerHashTable::decode(uint64_t key, int kmerLen){
+	static const char bases[4] = {'A', 'C', 'G', 'T'};
+	string kmerSeq(kmerLen, 'A');
+	for(int i = kmerLen - 1; i >= 0; i--){
+		kmerSeq[i] = bases[key & 3];
+		key >>= 2;
+	}
+	return kmerSeq;
+}
+
+/*** Key of a k-mer's reverse complement
+** Complement is the inverse of each 2-bit base, then bases are reversed within the word by swapping ever smaller groups
+**/
+uint64_t KmerHashTable::reverseComplement(uint64_t key, int kmerLen){
+	key = ~key;
+	key = ((key >> 2) & 0x3333333333333333ULL) | ((key & 0x3333333333333333ULL) << 2);
+	key = ((key >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((key & 0x0F0F0F0F0F0F0F0FULL) << 4);
+	key = ((key >> 8) & 0x00FF00FF00FF00FFULL) | ((key & 0x00FF00FF00FF00FFULL) << 8);
+	key = ((key >> 16) & 0x0000FFFF0000FFFFULL) | ((key & 0x0000FFFF0000FFFFULL) << 16);
+	key = (key >> 32) | (key << 32);
+	return key >> (64 - 2 * kmerLen);
+}
+
+/*** Key of the canonical form of a k-mer: the lesser of it and its reverse complement
+** Numeric order of keys being alphabetical order, this is also the alphabetically first orientation
+**/
+uint64_t KmerHashTable::canonical(uint64_t key, int kmerLen){
+	return min(key, reverseComplement(key, kmerLen));
+}
+
+/*** Slot number to start probing from for a key, by a 64-bit mix (splitmix64 finaliser)
+**/
+uint64_t KmerHashTable::hashSlot(uint64_t key) const{
+	key ^= key >> 30;
+	key *= 0xbf58476d1ce4e5b9ULL;
+	key ^= key >> 27;
+	key *= 0x94d049bb133111ebULL;
+	key ^= key >> 31;
+	return key & slotMask;
+}
+
+/*** Counts for a k-mer, or NULL if not held
+**/
+unsigned int* KmerHashTable::find(uint64_t key){
+	if(key == emptyKey){
+		return hasEmptyKeyKmer ? &emptyKeyCounts[0] : NULL;
+	}
+	for(uint64_t slot = hashSlot(key); ; slot = (slot + 1) & slotMask){
+		if(keys[slot] == key){
+			return &counts[slot * numSamples];
+		}else if(keys[slot] == emptyKey){
+			return NULL;
+		}
+	}
+}
+
+/*** Counts for a k-mer, added as all zero if not yet held
+**/
+unsigned int* KmerHashTable::insert(uint64_t key){
+	if(key == emptyKey){
+		if(!hasEmptyKeyKmer){
+			hasEmptyKeyKmer = true;
+			numKmers++;
+		}
+		return &emptyKeyCounts[0];
+	}
+	if((numKmers + 1) * 100 > keys.size() * maxLoadPercent){
+		grow();
+	}
+	uint64_t slot = hashSlot(key);
+	while(keys[slot] != emptyKey){
+		if(keys[slot] == key){
+			return &counts[slot * numSamples];
+		}
+		slot = (slot + 1) & slotMask;
+	}
+	keys[slot] = key;
+	numKmers++;
+	return &counts[slot * numSamples];
+}
+
+/*** Double table size and re-place all k-mers
+**/
+void KmerHashTable::grow(){
+	vector<uint64_t> oldKeys(keys.size() * 2, emptyKey);
+	vector<unsigned int> oldCounts(counts.size() * 2, 0);
+	oldKeys.swap(keys);
+	oldCounts.swap(counts);
+	slotMask = keys.size() - 1;
+	for(size_t oldSlot = 0; oldSlot < oldKeys.size(); oldSlot++){
+		if(oldKeys[oldSlot] != emptyKey){
+			uint64_t slot = hashSlot(oldKeys[oldSlot]);
+			while(keys[slot] != emptyKey){
+				slot = (slot + 1) & slotMask;
+			}
+			keys[slot] = oldKeys[oldSlot];
+			copy(oldCounts.begin() + oldSlot * numSamples, oldCounts.begin() + (oldSlot + 1) * numSamples, counts.begin() + slot * numSamples);
+		}
+	}
+}
+
+/*** Reserve space for at least this many k-mers
+**/
+void KmerHashTable::reserve(size_t aNumKmers){
+	while(aNumKmers * 100 > keys.size() * maxLoadPercent){
+		grow();
+	}
+}
+
+/*** Number of k-mers held
+**/
+size_t KmerHashTable::size() const{
+	return numKmers;
+}
+
+/*** Bytes held by the table
+**/
+size_t KmerHashTable::memBytes() const{
+	return keys.capacity() * sizeof(uint64_t) + (counts.capacity() + emptyKeyCounts.capacity()) * sizeof(unsigned int);
+}
+
+/*** List all keys held, in ascending (alphabetical) order
+**/
+void KmerHashTable::sortedKeys(vector<uint64_t>& sorted) const{
+	sorted.clear();
+	sorted.reserve(numKmers);
+	for(size_t slot = 0; slot < keys.size(); slot++){
+		if(keys[slot] != emptyKey){
+			sorted.push_back(keys[slot]);
+		}
+	}
+	sort(sorted.begin(), sorted.end());
+	if(hasEmptyKeyKmer){
+		sorted.push_back(emptyKey);
+	}
+}
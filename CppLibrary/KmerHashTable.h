@@ -0,0 +1,64 @@
+#ifndef KMERHASHTABLE_H
+#define KMERHASHTABLE_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/*** Table of per-sample counts for k-mers of up to 32 bases, keyed by 2-bit encoding (A=0, C=1, G=2, T=3).
+** Open addressing with linear probing.  Keys sit in one array and counts in one contiguous slab,
+** numSamples counts per slot, so a k-mer costs 8 + 4 x numSamples bytes per slot with no per-k-mer allocation.
+** Numeric order of keys is the alphabetical order of k-mers of one length.
+**/
+class KmerHashTable {
+	static const uint64_t emptyKey = ~0ULL; //!< Marks an unused slot (only a 32-mer of all T's encodes to this, held apart)
+	static const int maxLoadPercent = 70; //!< Table size doubles when fuller than this
+
+	int numSamples; //!< Counts per k-mer
+	vector<uint64_t> keys; //!< Key per slot, emptyKey if unused
+	vector<unsigned int> counts; //!< numSamples counts per slot
+	uint64_t slotMask; //!< Table size - 1, table size being a power of 2
+	size_t numKmers; //!< Slots in use, including the all-T's 32-mer if held
+	bool hasEmptyKeyKmer; //!< The all-T's 32-mer has been added
+	vector<unsigned int> emptyKeyCounts; //!< Counts for the all-T's 32-mer
+
+		/*** Slot number to start probing from for a key **/
+	uint64_t hashSlot(uint64_t key) const;
+		/*** Double table size and re-place all k-mers **/
+	void grow();
+
+  public:
+	KmerHashTable();
+		/*** Empty the table, ready for k-mers with this many counts each **/
+	void init(int aNumSamples);
+
+		/*** Encode a k-mer of up to 32 upper-case ACGT bases as a key.  Returns false if it can't be encoded **/
+	static bool encode(const string& kmerSeq, uint64_t& key);
+	static bool encode(const char* kmerSeq, int kmerLen, uint64_t& key);
+		/*** Decode a key back to its k-mer sequence **/
+	static string decode(uint64_t key, int kmerLen);
+		/*** Key of a k-mer's reverse complement **/
+	static uint64_t reverseComplement(uint64_t key, int kmerLen);
+		/*** Key of the canonical form of a k-mer: the lesser of it and its reverse complement **/
+	static uint64_t canonical(uint64_t key, int kmerLen);
+
+		/*** Counts for a k-mer, or NULL if not held **/
+	unsigned int* find(uint64_t key);
+		/*** Counts for a k-mer, added as all zero if not yet held **/
+	unsigned int* insert(uint64_t key);
+		/*** Number of k-mers held **/
+	size_t size() const;
+		/*** Bytes held by the table **/
+	size_t memBytes() const;
+		/*** Reserve space for at least this many k-mers **/
+	void reserve(size_t aNumKmers);
+		/*** List all keys held, in ascending (alphabetical) order **/
+	void sortedKeys(vector<uint64_t>& sorted) const;
+};
+
+#endif
@@ -0,0 +1,384 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <stdint.h>
+#include <unistd.h>
+#include "KmerRunSet.h"
+#include "KmerHashTable.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+const size_t KmerRunSet::maxMergeRuns;
+
+KmerRunSet::KmerRunSet(){
+	numSamples = 0;
+	kmerLen = 0;
+	compareBySeq = false;
+	sumCounts = false;
+	mergedRunsMade = 0;
+	rowKey = 0;
+}
+
+KmerRunSet::~KmerRunSet(){
+	removeRuns();
+}
+
+/*** Set up for runs in a temp directory
+**/
+void KmerRunSet::init(const string& aTempDir, const int aNumSamples, const int aKmerLen, const bool aSumCounts){
+	tempDir = aTempDir;
+	sumCounts = aSumCounts;
+	numSamples = aNumSamples;
+	kmerLen = aKmerLen;
+	sampleRunCounts.assign(numSamples, 0);
+	stringstream prefixSS;
+	prefixSS << tempDir << "/kmerRun." << getpid() << ".";
+	filePrefix = prefixSS.str();
+}
+
+/*** Sort and write a run of encoded kmers for a sample, emptying records.  Thread-safe.
+** Sort is stable so a kmer listed twice keeps its input order.
+**/
+bool KmerRunSet::writeRun(const int sNum, vector< KmerRecord >& records){
+	if(records.empty()){
+		return true;
+	}
+	stable_sort(records.begin(), records.end());
+
+	RunInfo newRun;
+	#pragma omp critical(kmerRunSetRuns)
+	{
+		newRun.sNum = sNum;
+		newRun.sampleRunNum = sampleRunCounts[sNum]++;
+		newRun.encoded = true;
+		newRun.merged = false;
+		stringstream fileNameSS;
+		fileNameSS << filePrefix << sNum << "." << newRun.sampleRunNum << ".bin";
+		newRun.fileName = fileNameSS.str();
+		runs.push_back(newRun);
+	}
+	ofstream outfile(newRun.fileName.c_str(), ios_base::out | ios_base::binary);
+	outfile.write((const char*)&records[0], records.size() * sizeof(KmerRecord));
+	records.clear();
+	if(!outfile){
+		cerr << "Unable to write temp file " << newRun.fileName << "!\n";
+		return false;
+	}
+	return true;
+}
+
+/*** Sort and write a run of other kmers for a sample, emptying records.  Thread-safe.
+** Each record as: length (4 bytes), kmer seq, count (4 bytes)
+**/
+bool KmerRunSet::writeSeqRun(const int sNum, vector< KmerSeqRecord >& records){
+	if(records.empty()){
+		return true;
+	}
+	stable_sort(records.begin(), records.end());
+
+	RunInfo newRun;
+	#pragma omp critical(kmerRunSetRuns)
+	{
+		newRun.sNum = sNum;
+		newRun.sampleRunNum = sampleRunCounts[sNum]++;
+		newRun.encoded = false;
+		newRun.merged = false;
+		stringstream fileNameSS;
+		fileNameSS << filePrefix << sNum << "." << newRun.sampleRunNum << ".bin";
+		newRun.fileName = fileNameSS.str();
+		runs.push_back(newRun);
+		compareBySeq = true;
+	}
+	ofstream outfile(newRun.fileName.c_str(), ios_base::out | ios_base::binary);
+	for(size_t i=0; i < records.size(); i++){
+		const uint32_t seqLen = records[i].kmerSeq.length();
+		outfile.write((const char*)&seqLen, sizeof(seqLen));
+		outfile.write(records[i].kmerSeq.data(), seqLen);
+		outfile.write((const char*)&records[i].count, sizeof(records[i].count));
+	}
+	records.clear();
+	if(!outfile){
+		cerr << "Unable to write temp file " << newRun.fileName << "!\n";
+		return false;
+	}
+	return true;
+}
+
+/*** Open all runs, ready for nextRow(), first merging them in groups if too many
+** Each group of consecutive runs is written back as one intermediate run, until few enough runs remain to merge at once.
+**/
+bool KmerRunSet::startMerge(){
+	// Runs in sample then input order, which settles ties between runs
+	sort(runs.begin(), runs.end());
+	while(runs.size() > maxMergeRuns){
+		vector< RunInfo > mergedRuns;
+		for(size_t firstRun = 0; firstRun < runs.size(); firstRun += maxMergeRuns){
+			const size_t endRun = min(firstRun + maxMergeRuns, runs.size());
+			if(endRun - firstRun == 1){
+				mergedRuns.push_back(runs[firstRun]);
+				continue;
+			}
+			RunInfo newRun;
+			const bool success = mergeRuns(firstRun, endRun, newRun);
+			mergedRuns.push_back(newRun);
+			for(size_t runNum = firstRun; runNum < endRun; runNum++){
+				remove(runs[runNum].fileName.c_str());
+			}
+			if(!success){
+				runs.swap(mergedRuns);
+				return false;
+			}
+		}
+		runs.swap(mergedRuns);
+	}
+	return openRuns(0, runs.size());
+}
+
+/*** Merge a range of runs into one intermediate run
+** Records as KmerSampleRecords, or if comparing by sequence: length (4 bytes), kmer seq, sample number (4 bytes), count (4 bytes)
+**/
+bool KmerRunSet::mergeRuns(const size_t firstRun, const size_t endRun, RunInfo& newRun){
+	newRun.sNum = -1;
+	newRun.sampleRunNum = mergedRunsMade++;
+	newRun.encoded = !compareBySeq;
+	newRun.merged = true;
+	stringstream fileNameSS;
+	fileNameSS << filePrefix << "merged." << newRun.sampleRunNum << ".bin";
+	newRun.fileName = fileNameSS.str();
+	if(!openRuns(firstRun, endRun)){
+		closeRuns();
+		return false;
+	}
+
+	ofstream outfile(newRun.fileName.c_str(), ios_base::out | ios_base::binary);
+	string kmerSeq;
+	vector< unsigned int > counts;
+	vector< KmerSampleRecord > records;
+	while(nextRow(kmerSeq, counts)){
+		sort(rowSamples.begin(), rowSamples.end());
+		for(size_t i=0; i < rowSamples.size(); i++){
+			const uint32_t sNum = rowSamples[i];
+			if(compareBySeq){
+				const uint32_t seqLen = kmerSeq.length();
+				outfile.write((const char*)&seqLen, sizeof(seqLen));
+				outfile.write(kmerSeq.data(), seqLen);
+				outfile.write((const char*)&sNum, sizeof(sNum));
+				outfile.write((const char*)&counts[sNum], sizeof(counts[sNum]));
+			}else{
+				KmerSampleRecord record;
+				record.key = rowKey;
+				record.sNum = sNum;
+				record.count = counts[sNum];
+				records.push_back(record);
+			}
+		}
+		if(records.size() >= readBufferRecords){
+			outfile.write((const char*)&records[0], records.size() * sizeof(KmerSampleRecord));
+			records.clear();
+		}
+	}
+	if(!records.empty()){
+		outfile.write((const char*)&records[0], records.size() * sizeof(KmerSampleRecord));
+	}
+	outfile.close();
+	closeRuns();
+	if(!outfile){
+		cerr << "Unable to write temp file " << newRun.fileName << "!\n";
+		return false;
+	}
+	return true;
+}
+
+/*** Open a range of runs for merging, ready for nextRow()
+**/
+bool KmerRunSet::openRuns(const size_t firstRun, const size_t endRun){
+	closeRuns();
+	readers.assign(runs.size(), NULL);
+	sampleInRow.assign(numSamples, false);
+	rowSamples.clear();
+	for(size_t runNum = firstRun; runNum < endRun; runNum++){
+		RunReader* reader = new RunReader();
+		readers[runNum] = reader;
+		reader->infile.open(runs[runNum].fileName.c_str(), ios_base::in | ios_base::binary);
+		if(!reader->infile.is_open()){
+			cerr << "Unable to open temp file " << runs[runNum].fileName << "!\n";
+			return false;
+		}
+		reader->bufferPos = 0;
+		reader->done = false;
+		reader->sNum = runs[runNum].sNum;
+		if(readNext(runNum)){
+			heap.push_back(runNum);
+		}
+	}
+	for(size_t pos = heap.size() / 2; pos > 0; pos--){
+		siftDown(pos - 1);
+	}
+	return true;
+}
+
+/*** Close any open runs
+**/
+void KmerRunSet::closeRuns(){
+	for(size_t runNum = 0; runNum < readers.size(); runNum++){
+		delete readers[runNum];
+	}
+	readers.clear();
+	heap.clear();
+}
+
+/*** Read next record of a run into its reader, returns false at end
+**/
+bool KmerRunSet::readNext(const int runNum){
+	RunReader& reader = *readers[runNum];
+	if(reader.done){
+		return false;
+	}
+	if(runs[runNum].encoded && runs[runNum].merged){
+		if(reader.bufferPos == reader.sampleBuffer.size()){
+			reader.sampleBuffer.resize(readBufferRecords);
+			reader.infile.read((char*)&reader.sampleBuffer[0], readBufferRecords * sizeof(KmerSampleRecord));
+			reader.sampleBuffer.resize(reader.infile.gcount() / sizeof(KmerSampleRecord));
+			reader.bufferPos = 0;
+			if(reader.sampleBuffer.empty()){
+				reader.done = true;
+				return false;
+			}
+		}
+		reader.key = reader.sampleBuffer[reader.bufferPos].key;
+		reader.sNum = reader.sampleBuffer[reader.bufferPos].sNum;
+		reader.count = reader.sampleBuffer[reader.bufferPos].count;
+		reader.bufferPos++;
+	}else if(runs[runNum].encoded){
+		if(reader.bufferPos == reader.buffer.size()){
+			reader.buffer.resize(readBufferRecords);
+			reader.infile.read((char*)&reader.buffer[0], readBufferRecords * sizeof(KmerRecord));
+			reader.buffer.resize(reader.infile.gcount() / sizeof(KmerRecord));
+			reader.bufferPos = 0;
+			if(reader.buffer.empty()){
+				reader.done = true;
+				return false;
+			}
+		}
+		reader.key = reader.buffer[reader.bufferPos].key;
+		reader.count = reader.buffer[reader.bufferPos].count;
+		reader.bufferPos++;
+		if(compareBySeq){
+			reader.kmerSeq = KmerHashTable::decode(reader.key, kmerLen);
+		}
+	}else{
+		uint32_t seqLen;
+		if(!reader.infile.read((char*)&seqLen, sizeof(seqLen))){
+			reader.done = true;
+			return false;
+		}
+		reader.kmerSeq.resize(seqLen);
+		reader.infile.read(&reader.kmerSeq[0], seqLen);
+		if(runs[runNum].merged){
+			reader.infile.read((char*)&reader.sNum, sizeof(reader.sNum));
+		}
+		reader.infile.read((char*)&reader.count, sizeof(reader.count));
+	}
+	return true;
+}
+
+/*** Heap ordering, true if run a's record comes after run b's
+**/
+bool KmerRunSet::after(const int runA, const int runB) const{
+	const RunReader& readerA = *readers[runA];
+	const RunReader& readerB = *readers[runB];
+	if(compareBySeq){
+		const int cmp = readerA.kmerSeq.compare(readerB.kmerSeq);
+		if(cmp != 0){
+			return (cmp > 0);
+		}
+	}else if(readerA.key != readerB.key){
+		return (readerA.key > readerB.key);
+	}
+	return (runA > runB);
+}
+
+/*** Restore heap order downward from a position
+**/
+void KmerRunSet::siftDown(size_t pos){
+	while(true){
+		size_t first = pos;
+		const size_t left = 2 * pos + 1;
+		const size_t right = left + 1;
+		if(left < heap.size() && after(heap[first], heap[left])){
+			first = left;
+		}
+		if(right < heap.size() && after(heap[first], heap[right])){
+			first = right;
+		}
+		if(first == pos){
+			return;
+		}
+		swap(heap[pos], heap[first]);
+		pos = first;
+	}
+}
+
+/*** Next kmer in alphabetical order with its counts per sample, returns false once all merged
+**/
+bool KmerRunSet::nextRow(string& kmerSeq, vector< unsigned int >& counts){
+	if(heap.empty()){
+		return false;
+	}
+	const RunReader& first = *readers[heap[0]];
+	const uint64_t key = first.key;
+	rowKey = key;
+	if(compareBySeq){
+		kmerSeq = first.kmerSeq;
+	}else{
+		kmerSeq = KmerHashTable::decode(key, kmerLen);
+	}
+	counts.assign(numSamples, 0);
+	for(size_t i=0; i < rowSamples.size(); i++){
+		sampleInRow[rowSamples[i]] = false;
+	}
+	rowSamples.clear();
+
+	// Take every run's records for this kmer, in run order so a sample's last count is kept (unless summing)
+	while(!heap.empty()){
+		const int runNum = heap[0];
+		const RunReader& reader = *readers[runNum];
+		if((compareBySeq && reader.kmerSeq != kmerSeq) || (!compareBySeq && reader.key != key)){
+			break;
+		}
+		if(!sampleInRow[reader.sNum]){
+			sampleInRow[reader.sNum] = true;
+			rowSamples.push_back(reader.sNum);
+		}
+		if(sumCounts){
+			counts[reader.sNum] += reader.count;
+		}else{
+			counts[reader.sNum] = reader.count;
+		}
+		if(!readNext(runNum)){
+			heap[0] = heap.back();
+			heap.pop_back();
+		}
+		if(!heap.empty()){
+			siftDown(0);
+		}
+	}
+	return true;
+}
+
+/*** Close and delete all run files
+**/
+void KmerRunSet::removeRuns(){
+	closeRuns();
+	for(size_t runNum = 0; runNum < runs.size(); runNum++){
+		remove(runs[runNum].fileName.c_str());
+	}
+	runs.clear();
+}
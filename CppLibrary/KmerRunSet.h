@@ -0,0 +1,120 @@
+#ifndef KMERRUNSET_H
+#define KMERRUNSET_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdint.h>
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+struct KmerRecord {
+	uint64_t key;
+	unsigned int count;
+
+	bool operator < (const KmerRecord& other) const{
+		return (key < other.key);
+	}
+}; //!< 2-bit encoded kmer (see KmerHashTable) and its count in one sample
+
+struct KmerSeqRecord {
+	string kmerSeq;
+	unsigned int count;
+
+	bool operator < (const KmerSeqRecord& other) const{
+		return (kmerSeq < other.kmerSeq);
+	}
+}; //!< Kmer that can't be encoded and its count in one sample
+
+struct KmerSampleRecord {
+	uint64_t key;
+	uint32_t sNum;
+	unsigned int count;
+}; //!< 2-bit encoded kmer and its count in a given sample, as held in intermediate runs
+
+/*** Set of sorted runs of kmer counts on disk, for merging samples in bounded memory.
+** Each run holds one sample's kmers, sorted; a sample may have several runs, numbered in input order.
+** Runs are then merged with a k-way heap merge, giving each kmer's counts across all samples in alphabetical order.
+** Where a sample lists a kmer more than once, its last count is kept, or its counts added if sumCounts.
+** Beyond maxMergeRuns, consecutive runs are first merged in groups into intermediate runs, whose records each carry their sample,
+** so the number of open files stays bounded.  Groups keep run order, so a sample's last count is still the one kept.
+**/
+class KmerRunSet {
+	struct RunInfo {
+		string fileName;
+		int sNum;
+		int sampleRunNum; //!< Order of run within its sample's input
+		bool encoded; //!< Run of KmerRecords, else KmerSeqRecords
+		bool merged; //!< Intermediate run of several samples' records, each with its sample number
+
+		bool operator < (const RunInfo& other) const{
+			if(sNum != other.sNum){
+				return (sNum < other.sNum);
+			}
+			return (sampleRunNum < other.sampleRunNum);
+		}
+	};
+	struct RunReader {
+		ifstream infile;
+		vector< KmerRecord > buffer; //!< Encoded runs, records read ahead
+		vector< KmerSampleRecord > sampleBuffer; //!< Encoded intermediate runs, records read ahead
+		size_t bufferPos;
+		bool done;
+		uint64_t key; //!< Current record...
+		string kmerSeq;
+		uint32_t sNum;
+		unsigned int count;
+	};
+	static const int readBufferRecords = 4096; //!< Records read ahead per encoded run when merging
+	static const size_t maxMergeRuns = 64; //!< Most runs open at once when merging
+
+	string tempDir; //!< Directory for run files
+	string filePrefix; //!< Start of run file names, unique to this process
+	int numSamples;
+	int kmerLen; //!< Length of encoded kmers
+	vector< RunInfo > runs;
+	vector< int > sampleRunCounts; //!< Runs written so far per sample
+	int mergedRunsMade; //!< Intermediate runs written so far, numbering the next
+	vector< RunReader* > readers; //!< One per run while merging, NULL for runs not open
+	vector< int > heap; //!< Run numbers, as a heap on their current records
+	uint64_t rowKey; //!< Encoded kmer of the last row
+	vector< int > rowSamples; //!< Samples with a count in the last row
+	vector< bool > sampleInRow; //!< Per sample, has a count in the row being merged
+	bool compareBySeq; //!< Some runs hold kmers that can't be encoded, so all are compared as sequences
+	bool sumCounts; //!< A sample's counts for a kmer are added, rather than its last count kept
+
+		/*** Merge a range of runs into one intermediate run **/
+	bool mergeRuns(const size_t firstRun, const size_t endRun, RunInfo& newRun);
+		/*** Open a range of runs for merging, ready for nextRow() **/
+	bool openRuns(const size_t firstRun, const size_t endRun);
+		/*** Close any open runs **/
+	void closeRuns();
+		/*** Read next record of a run into its reader, returns false at end **/
+	bool readNext(const int runNum);
+		/*** Heap ordering, true if run a's record comes after run b's **/
+	bool after(const int runA, const int runB) const;
+		/*** Restore heap order downward from a position **/
+	void siftDown(size_t pos);
+
+  public:
+	KmerRunSet();
+		/*** Set up for runs in a temp directory **/
+	void init(const string& aTempDir, const int aNumSamples, const int aKmerLen, const bool aSumCounts);
+		/*** Sort and write a run of encoded kmers for a sample, emptying records.  Thread-safe. **/
+	bool writeRun(const int sNum, vector< KmerRecord >& records);
+		/*** Sort and write a run of other kmers for a sample, emptying records.  Thread-safe. **/
+	bool writeSeqRun(const int sNum, vector< KmerSeqRecord >& records);
+		/*** Open all runs, ready for nextRow(), first merging them in groups if too many **/
+	bool startMerge();
+		/*** Next kmer in alphabetical order with its counts per sample, returns false once all merged **/
+	bool nextRow(string& kmerSeq, vector< unsigned int >& counts);
+		/*** Close and delete all run files **/
+	void removeRuns();
+	~KmerRunSet();
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include <vector>
+#include <map>
+#include "LengthHistogram.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+LengthHistogram::LengthHistogram(){
+	clear();
+}
+
+/*** Empty the histogram
+**/
+void LengthHistogram::clear(){
+	denseCounts.clear();
+	sparseCounts.clear();
+	numSeqs = 0;
+	totalLen = 0;
+}
+
+/*** Count a sequence of this length
+**/
+void LengthHistogram::add(unsigned int len){
+	numSeqs++;
+	totalLen += len;
+	if(len > maxDenseLen){
+		sparseCounts[len]++;
+		return;
+	}
+	if(len >= denseCounts.size()){
+		denseCounts.resize(len + 1, 0);
+	}
+	denseCounts[len]++;
+}
+
+/*** Number of sequences of a length
+**/
+unsigned long LengthHistogram::count(unsigned int len) const{
+	if(len < denseCounts.size()){
+		return denseCounts[len];
+	}
+	map<unsigned int, unsigned long>::const_iterator it = sparseCounts.find(len);
+	return (it == sparseCounts.end()) ? 0 : it->second;
+}
+
+/*** One past the longest length counted, or 0 if none
+**/
+size_t LengthHistogram::size() const{
+	if(!sparseCounts.empty()){
+		return (size_t)sparseCounts.rbegin()->first + 1;
+	}
+	return denseCounts.size();
+}
+
+/*** Length of the sequence at a rank (from 0) in ascending order of length
+**/
+unsigned int LengthHistogram::lengthAtRank(unsigned long rank) const{
+	unsigned long seqsBelow = 0;
+	for(unsigned int len = 0; len < denseCounts.size(); len++){
+		seqsBelow += denseCounts[len];
+		if(rank < seqsBelow){
+			return len;
+		}
+	}
+	for(map<unsigned int, unsigned long>::const_iterator it = sparseCounts.begin(); it != sparseCounts.end(); ++it){
+		seqsBelow += it->second;
+		if(rank < seqsBelow){
+			return it->first;
+		}
+	}
+	return 0;
+}
+
+/*** Median length, of an even count being the integer mean of the middle two, or 0 if none
+**/
+unsigned int LengthHistogram::median() const{
+	if(numSeqs == 0){
+		return 0;
+	}
+	if(numSeqs % 2 == 1){
+		return lengthAtRank(numSeqs / 2);
+	}
+	return (lengthAtRank(numSeqs / 2) + lengthAtRank(numSeqs / 2 - 1)) / 2;
+}
+
+/*** Adding lengths shortest first, the length at which half the combined length is reached, or 0 if none
+** Being the shortest length whose sequences, with all shorter ones, make up at least half the combined length.
+**/
+unsigned int LengthHistogram::n50() const{
+	const double halfLen = totalLen / 2.0;
+	unsigned long long lenBelow = 0;
+	for(unsigned int len = 0; len < denseCounts.size(); len++){
+		lenBelow += (unsigned long long)len * denseCounts[len];
+		if(denseCounts[len] > 0 && lenBelow >= halfLen){
+			return len;
+		}
+	}
+	for(map<unsigned int, unsigned long>::const_iterator it = sparseCounts.begin(); it != sparseCounts.end(); ++it){
+		lenBelow += (unsigned long long)it->first * it->second;
+		if(lenBelow >= halfLen){
+			return it->first;
+		}
+	}
+	return 0;
+}
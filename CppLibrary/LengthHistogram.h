@@ -0,0 +1,43 @@
+#ifndef LENGTHHISTOGRAM_H
+#define LENGTHHISTOGRAM_H
+
+#include <vector>
+#include <map>
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/*** Exact count of sequences per length, in memory by number of distinct lengths rather than number of sequences.
+** Short lengths (reads) are counted in a dense array, grown as needed; longer lengths (contigs etc.) in a sparse map.
+** Median and N50 come from walking lengths in ascending order.
+**/
+class LengthHistogram {
+	static const unsigned int maxDenseLen = 65535; //!< Longest length counted in the dense array
+
+	vector<unsigned long> denseCounts; //!< Sequences per length, up to maxDenseLen
+	map<unsigned int, unsigned long> sparseCounts; //!< Sequences per longer length
+	unsigned long numSeqs;
+	unsigned long long totalLen;
+
+		/*** Length of the sequence at a rank (from 0) in ascending order of length **/
+	unsigned int lengthAtRank(unsigned long rank) const;
+
+  public:
+	LengthHistogram();
+		/*** Empty the histogram **/
+	void clear();
+		/*** Count a sequence of this length **/
+	void add(unsigned int len);
+		/*** Number of sequences of a length **/
+	unsigned long count(unsigned int len) const;
+		/*** One past the longest length counted, or 0 if none **/
+	size_t size() const;
+		/*** Median length, of an even count being the integer mean of the middle two, or 0 if none **/
+	unsigned int median() const;
+		/*** Adding lengths shortest first, the length at which half the combined length is reached, or 0 if none **/
+	unsigned int n50() const;
+};
+
+#endif
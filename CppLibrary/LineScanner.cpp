@@ -0,0 +1,80 @@
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include "LineScanner.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+LineScanner::LineScanner(istream& aIn, size_t bufferBytes) : in(aIn){
+	buffer.resize(bufferBytes);
+	start = 0;
+	end = 0;
+	atEOF = false;
+}
+
+/*** Move unread data to the front of the buffer and fill the rest from the stream
+**/
+void LineScanner::refill(){
+	if(start > 0){
+		memmove(&buffer[0], &buffer[start], end - start);
+		end -= start;
+		start = 0;
+	}
+	if(end == buffer.size()){
+		buffer.resize(buffer.size() * 2);
+	}
+	in.read(&buffer[end], buffer.size() - end);
+	end += in.gcount();
+	if(in.gcount() == 0){
+		atEOF = true;
+	}
+}
+
+/*** Next line, as pointer and length.  Returns false at end of stream
+**/
+bool LineScanner::nextLine(const char*& line, size_t& lineLen){
+	size_t searchFrom = start;
+	while(true){
+		const char* lineEnd = (const char*)memchr(&buffer[0] + searchFrom, '\n', end - searchFrom);
+		if(lineEnd != NULL){
+			line = &buffer[start];
+			lineLen = lineEnd - line;
+			start += lineLen + 1;
+			break;
+		}
+		if(atEOF){
+			if(start == end){
+				return false;
+			}
+			// Last line, without a line end
+			line = &buffer[start];
+			lineLen = end - start;
+			start = end;
+			break;
+		}
+		const size_t searched = end - start;
+		refill();
+		searchFrom = start + searched;
+	}
+	if(lineLen > 0 && line[lineLen - 1] == '\r'){
+		lineLen--;
+	}
+	return true;
+}
+
+/*** Parse an unsigned decimal number from the start of text (after any spaces), stopping at the first non-digit.  0 if no digits
+**/
+unsigned int LineScanner::parseUInt(const char* text, const char* textEnd){
+	while(text < textEnd && (*text == ' ' || *text == '\t')){
+		text++;
+	}
+	unsigned int value = 0;
+	while(text < textEnd && *text >= '0' && *text <= '9'){
+		value = value * 10 + (*text - '0');
+		text++;
+	}
+	return value;
+}
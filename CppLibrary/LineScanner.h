@@ -0,0 +1,34 @@
+#ifndef LINESCANNER_H
+#define LINESCANNER_H
+
+#include <iostream>
+#include <vector>
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/*** Reads lines from a stream in large blocks, handing out pointers into its buffer rather than copying each line to a string.
+** A line is only valid until the next call to nextLine().  Line ends (\n or \r\n) are not included.
+** Lines longer than the buffer grow it.
+**/
+class LineScanner {
+	istream& in;
+	vector<char> buffer;
+	size_t start; //!< Start of unread data in buffer
+	size_t end; //!< End of data in buffer
+	bool atEOF; //!< No more to read from stream
+
+		/*** Move unread data to the front of the buffer and fill the rest from the stream **/
+	void refill();
+
+  public:
+	LineScanner(istream& aIn, size_t bufferBytes = 1048576);
+		/*** Next line, as pointer and length.  Returns false at end of stream **/
+	bool nextLine(const char*& line, size_t& lineLen);
+		/*** Parse an unsigned decimal number from the start of text (after any spaces), stopping at the first non-digit.  0 if no digits **/
+	static unsigned int parseUInt(const char* text, const char* textEnd);
+};
+
+#endif
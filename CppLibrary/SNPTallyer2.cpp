@@ -9,6 +9,9 @@
 #include <ctype.h>
 #include <sstream>
 #include <algorithm>
+#include <climits>
+#include <unistd.h>
+#include <sys/resource.h>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include "SNPTallyer2.h"
@@ -26,7 +29,12 @@ SNPTallyer::SNPTallyer(const vector<string>& aLabelsList,
 						const string& aOutTabFileName, 
 						const int aOutFormat, 
 						const int aReadDepthMin, 
-						const int aEdgeBuffer){
+						const int aEdgeBuffer, 
+						const bool aResume, 
+						const int aMaxMemMB, 
+						const int aMinMapQ, 
+						const int aMinBaseQual, 
+						const bool aDiscoverMode){
 	prepareSNPTallyer(aLabelsList, 
 					aSAMFileNamesList, 
 					aSNPFileNamesList, 
@@ -34,7 +42,12 @@ SNPTallyer::SNPTallyer(const vector<string>& aLabelsList,
 					aOutTabFileName, 
 					aOutFormat, 
 					aReadDepthMin, 
-					aEdgeBuffer);
+					aEdgeBuffer, 
+					aResume, 
+					aMaxMemMB, 
+					aMinMapQ, 
+					aMinBaseQual, 
+					aDiscoverMode);
 	return;
 }
 
@@ -47,7 +60,12 @@ void SNPTallyer::prepareSNPTallyer(const vector<string>& aLabelsList,
 								const string& aOutTabFileName, 
 								const int aOutFormat, 
 								const int aReadDepthMin, 
-								const int aEdgeBuffer){
+								const int aEdgeBuffer, 
+								const bool aResume, 
+								const int aMaxMemMB, 
+								const int aMinMapQ, 
+								const int aMinBaseQual, 
+								const bool aDiscoverMode){
 
 	filesReady = false;
 	snpsPreLoaded = false;
@@ -59,6 +77,20 @@ void SNPTallyer::prepareSNPTallyer(const vector<string>& aLabelsList,
 	readsLoadedFor = "noneyet";
 	readDepthMin = aReadDepthMin;
 	edgeBuffer = aEdgeBuffer;
+	minMapQ = aMinMapQ;
+	minBaseQual = aMinBaseQual;
+	if(minBaseQual > AlignedRead::maxQual){
+		minBaseQual = AlignedRead::maxQual;
+	}
+	discoverMode = aDiscoverMode;
+	resume = aResume;
+	maxMemBytes = 0;
+	if(aMaxMemMB > 0){
+		maxMemBytes = (unsigned long long)aMaxMemMB << 20;
+	}
+	peakReadBytes = 0;
+	peakCountsBytes = 0;
+	ckptFileName = aOutTabFileName + ".ckpt";
 	outFormat = aOutFormat;
 	if(outFormat < 1 || outFormat > 3){
 		cerr << "Invalid output format option!\nNo SNP detection will follow.\n";
@@ -71,12 +103,40 @@ void SNPTallyer::prepareSNPTallyer(const vector<string>& aLabelsList,
 		omp_init_lock(&ompWriteLocks[sNum]);
 	}
 	
-	outtabfile.open(aOutTabFileName.c_str());
+	if(resume){
+		if(!loadCheckpoint(aOutTabFileName)){
+			cerr << "Unable to resume from checkpoint file " << ckptFileName << "!\nNo SNP detection will follow.\n";
+			return;
+		}
+	}
+	
+	if(resume){
+			// Re-open existing output without truncation, appending after last completed reference sequence
+		outtabfile.open(aOutTabFileName.c_str(), ios_base::in | ios_base::out);
+		outtabfile.seekp(0, ios_base::end);
+	}else{
+		outtabfile.open(aOutTabFileName.c_str());
+	}
 	if(!outtabfile.is_open()){
 		cerr << "Unable to open output file " << aOutTabFileName << "!\nNo SNP detection will follow.\n";
 		return;
 	}
 	
+	if(resume){
+		ckptfile.open(ckptFileName.c_str(), ios_base::out | ios_base::app);
+	}else{
+		ckptfile.open(ckptFileName.c_str());
+	}
+	if(!ckptfile.is_open()){
+		cerr << "Unable to open checkpoint file " << ckptFileName << "!\nNo SNP detection will follow.\n";
+		return;
+	}
+	
+	if(resume){
+		filesReady = true;
+		return;
+	}
+	
 	switch(outFormat){
 		case 1:
 			outtabfile << "RefID\tSNPCoord\tRefBase\tSNPBase";
@@ -101,6 +161,7 @@ void SNPTallyer::prepareSNPTallyer(const vector<string>& aLabelsList,
 			break;
 	}
 	outtabfile << "\n";
+	writeCheckpoint("#header");
 	
 	filesReady = true;
 	return;
@@ -111,6 +172,9 @@ SNPTallyer::~SNPTallyer(){
 	if(outtabfile.is_open()){
 		outtabfile.close();
 	}
+	if(ckptfile.is_open()){
+		ckptfile.close();
+	}
 	for(int sNum=0; sNum < numSamples; sNum++){
 		omp_destroy_lock(&ompWriteLocks[sNum]);
 	}
@@ -124,21 +188,117 @@ bool SNPTallyer::tallySNPs(){
 		return false;
 	}
 	
-	if(!loadSNPLists()){
+	if(!discoverMode && !loadSNPLists()){
 		cerr << "Failed to load any starting SNPs from biokanga-align SNP files." << endl;
 		return false;
 	}else{
 		// For each reference sequence
 		SeqReader refSeqReader(inRefSeqFileName);
 		while(refSeqReader.nextSeq()){
-			if(! tallySNPsOnRef(refSeqReader.getSeq(), refSeqReader.getSeqID()) ){
+			string refID = refSeqReader.getSeqID();
+			if(refsDone.count(refID) > 0){
+				cout << "Skipping " << refID << ", completed by an earlier run" << endl;
+				continue;
+			}
+			if(! tallySNPsOnRef(refSeqReader.getSeq(), refID) ){
 				return false;
 			}
+			writeCheckpoint(refID);
+		}
+	}
+	
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	if(discoverMode){
+		cout << "Peak memory used by pileup counters: " << (peakCountsBytes >> 20) << " MB";
+	}else{
+		cout << "Peak memory used by loaded reads: " << (peakReadBytes >> 20) << " MB";
+	}
+	cout << " (peak process memory: " << (usage.ru_maxrss >> 10) << " MB)" << endl;
+	return true;
+}
+
+/*** Read checkpoint file of an earlier run, truncate output file back to the last completed reference sequence
+** Checkpoint lines are refID \t output file offset after that refID, first line being "#header" for the column headers.
+** Only newline-terminated lines are trusted, as a killed run may have left a partial last line.
+**/
+bool SNPTallyer::loadCheckpoint(const string& aOutTabFileName){
+	ifstream infile(ckptFileName.c_str());
+	if(!infile.is_open()){
+		cout << "No checkpoint file " << ckptFileName << " found, starting from the beginning." << endl;
+		resume = false;
+		return true;
+	}
+	
+	vector<string> doneRefIDs;
+	vector<long long> doneOffsets;
+	string line;
+	while(getline(infile, line)){
+		if(infile.eof()){
+			break;
+		}
+		size_t tabPos = line.find('\t');
+		if(tabPos != string::npos && tabPos > 0){
+			stringstream offsetSS(line.substr(tabPos+1));
+			long long offset;
+			if(offsetSS >> offset){
+				doneRefIDs.push_back(line.substr(0, tabPos));
+				doneOffsets.push_back(offset);
+			}
+		}
+	}
+	infile.close();
+	
+	if(doneRefIDs.empty() || doneRefIDs[0] != "#header"){
+		cout << "Checkpoint file " << ckptFileName << " has no completed output, starting from the beginning." << endl;
+		resume = false;
+		return true;
+	}
+	
+	long long lastOffset = doneOffsets.back();
+	ifstream outCheck(aOutTabFileName.c_str(), ios_base::in | ios_base::binary | ios_base::ate);
+	if(!outCheck.is_open()){
+		cerr << "Unable to open output file " << aOutTabFileName << " to resume!\n";
+		return false;
+	}
+	long long outSize = outCheck.tellg();
+	outCheck.close();
+	if(outSize < lastOffset){
+		cerr << "Output file " << aOutTabFileName << " is shorter than recorded in " << ckptFileName << "!\n";
+		return false;
+	}
+		// Discard any output from a reference sequence that was not completed
+	if(truncate(aOutTabFileName.c_str(), lastOffset) != 0){
+		cerr << "Unable to truncate output file " << aOutTabFileName << " to resume!\n";
+		return false;
+	}
+	
+		// Rewrite checkpoint without any partial last line, so appending can follow
+	ofstream outfile(ckptFileName.c_str());
+	if(!outfile.is_open()){
+		return false;
+	}
+	for(int i=0; i < doneRefIDs.size(); i++){
+		outfile << doneRefIDs[i] << "\t" << doneOffsets[i] << "\n";
+		if(i > 0){
+			refsDone.insert(doneRefIDs[i]);
 		}
 	}
+	outfile.close();
+	
+	cout << "Resuming from " << ckptFileName << ", " << refsDone.size() << " reference sequences already completed." << endl;
 	return true;
 }
 
+/*** Record a completed reference sequence, with output file offset, to the checkpoint file
+**/
+void SNPTallyer::writeCheckpoint(const string& refID){
+	outtabfile.flush();
+	ckptfile << refID << "\t" << (long long)outtabfile.tellp() << "\n";
+	ckptfile.flush();
+	return;
+}
+
 /*** Read Biokanga-Align SNP lists to form starting list of SNP locations
 **/
 bool SNPTallyer::loadSNPLists(){
@@ -232,6 +392,9 @@ bool SNPTallyer::tallySNPsOnRef(const string& refSeq, const string& refID){
 	if(!filesReady){
 		return false;
 	}
+	if(discoverMode){
+		return discoverSNPsOnRef(refSeq, refID);
+	}
 	if(!snpsPreLoaded){
 		if(!loadSNPLists()){
 			cerr << "Failed to load any starting SNPs from biokanga-align SNP files." << endl;
@@ -244,45 +407,297 @@ bool SNPTallyer::tallySNPsOnRef(const string& refSeq, const string& refID){
 		int refSeqLen = refSeq.length();
 		cout << "Working on " << refID << " (length = " << refSeqLen << ")... \n";
 		
-		// Load aligned reads from SAM files
-		readReadsAll(refID, refSeqLen);
+		// Split reference into coordinate windows fitting the memory budget
+		vector<int> windowStarts;
+		vector<int> windowEnds;
+		planReadWindows(refID, refSeqLen, windowStarts, windowEnds);
 		
-		// For each SNP on this RefSeq
 		unsigned int snpPrintCount = 0;
-		for(set<unsigned int>::iterator snpCoord=snpPreList[refID].begin(); snpCoord!=snpPreList[refID].end(); ++snpCoord){
-			if(testSNP(*snpCoord, refSeq[*snpCoord], refID)){
-				snpPrintCount++;
+		const set<unsigned int>& refSNPs = snpPreList[refID];
+		for(int wNum=0; wNum < windowStarts.size(); wNum++){
+			
+			// Load aligned reads from SAM files
+			readReadsAll(refID, windowStarts[wNum], windowEnds[wNum]);
+			
+			// For each SNP on this RefSeq, within this window
+			set<unsigned int>::const_iterator snpCoord = refSNPs.lower_bound(windowStarts[wNum]);
+			for(; snpCoord!=refSNPs.end() && *snpCoord <= windowEnds[wNum]; ++snpCoord){
+				if(testSNP(*snpCoord, refSeq[*snpCoord], refID)){
+					snpPrintCount++;
+				}
 			}
 		}
+		reads.clear();
+		readsLoadedFor = "noneyet";
 		cout << "Output SNPs at " << snpPrintCount << " coords on " << refID << endl;
 	}
 		
 	return true;
 }
 
-/*** Load read alignments against a reference seq, from SAM files, for all samples 
+/*** Split a reference seq into coordinate windows, each holding no more than maxMemBytes of aligned reads (or a single bin if that is exceeded).
+** Without a memory budget, or for a reference seq short enough to fit it even at high depth, the reference is a single window.
+** Otherwise a counting pass over the SAM files measures read storage per bin.
 **/
-void SNPTallyer::readReadsAll(const string& refID, int refSeqLen){
-	reads.clear();
-	for(int sNum=0; sNum < numSamples; sNum++){
-		reads.push_back(vector<AlignedRead>());
+void SNPTallyer::planReadWindows(const string& refID, int refSeqLen, vector<int>& windowStarts, vector<int>& windowEnds){
+	windowStarts.clear();
+	windowEnds.clear();
+	if(maxMemBytes == 0 || (unsigned long long)refSeqLen * numSamples * memBytesPerRefPos <= maxMemBytes){
+		windowStarts.push_back(0);
+		windowEnds.push_back(INT_MAX);
+		return;
 	}
 	
+	const int numBins = refSeqLen / memBinSize + 1;
+	vector<vector<unsigned long long> > sampBinBytes(numSamples, vector<unsigned long long>(numBins, 0));
+	
 	#pragma omp parallel for
-	for(int sNum=0; sNum < numSamples; sNum++){	
-		int totalReads = readReadsSample(inSAMFileNames[sNum], refID, reads[sNum]);
-		cout << "Loaded " << totalReads << " reads aligned to " << refID << " from " << labels[sNum] << endl;
+	for(int sNum=0; sNum < numSamples; sNum++){
+		countReadsSample(inSAMFileNames[sNum], refID, sampBinBytes[sNum]);
 	}
-	readsLoadedFor = refID;
+	
+	vector<unsigned long long> binBytes(numBins, 0);
+	unsigned long long totalBytes = 0;
+	for(int sNum=0; sNum < numSamples; sNum++){
+		for(int bin=0; bin < numBins; bin++){
+			binBytes[bin] += sampBinBytes[sNum][bin];
+			totalBytes += sampBinBytes[sNum][bin];
+		}
+	}
+	
+	// Greedily grow each window by bins until the budget would be exceeded
+	int wStartBin = 0;
+	unsigned long long wBytes = 0;
+	for(int bin=0; bin < numBins; bin++){
+		if(bin > wStartBin && wBytes + binBytes[bin] > maxMemBytes){
+			windowStarts.push_back(wStartBin * memBinSize);
+			windowEnds.push_back(bin * memBinSize - 1);
+			wStartBin = bin;
+			wBytes = 0;
+		}
+		wBytes += binBytes[bin];
+	}
+	windowStarts.push_back(wStartBin * memBinSize);
+	windowEnds.push_back(INT_MAX);
+	
+	cout << "Reads aligned to " << refID << " need ~" << (totalBytes >> 20) << " MB, processing in " << windowStarts.size() << " window(s)" << endl;
 	return;
 }
 
-/*** Load read alignments against a reference seq, from SAM files, for a single sample, adding to vector of aligned reads
+/*** Discover SNPs against a single reference sequence, testing every covered position rather than a pre-listed set
+** Pileups are streamed from the SAM files into per-sample, per-position base counters without holding reads.
+** The whole reference seq is piled up in one pass over each SAM file, unless a memory budget is set,
+** when it is split into windows to fit, each window re-reading the SAM files.
+**/
+bool SNPTallyer::discoverSNPsOnRef(const string& refSeq, const string& refID){
+	int refSeqLen = refSeq.length();
+	cout << "Working on " << refID << " (length = " << refSeqLen << ")... \n";
+	
+	// Window length such that counters for all samples fit the memory budget, if set.
+	// Every window re-reads each SAM file in full, so windows are kept as long as the budget allows.
+	int winLen = refSeqLen;
+	if(maxMemBytes > 0){
+		unsigned long long budgetLen = maxMemBytes / ((unsigned long long)numSamples * pileupPlanes * sizeof(unsigned short));
+		if(budgetLen < memBinSize){
+			budgetLen = memBinSize;
+		}
+		if(budgetLen < (unsigned long long)winLen){
+			winLen = budgetLen;
+		}
+	}
+	
+	vector<vector<unsigned short> > counts(numSamples);
+	vector<unsigned char> refCodes;
+	vector<unsigned char> hits;
+	unsigned int snpPrintCount = 0;
+	for(int winStart=0; winStart < refSeqLen; winStart += winLen){
+		int winEnd = winStart + winLen - 1;
+		if(winEnd >= refSeqLen){
+			winEnd = refSeqLen - 1;
+		}
+		const int thisLen = winEnd - winStart + 1;
+		
+		#pragma omp parallel for
+		for(int sNum=0; sNum < numSamples; sNum++){
+			counts[sNum].assign(pileupPlanes * (size_t)thisLen, 0);
+			unsigned int totalReads = countPileupSample(inSAMFileNames[sNum], refID, winStart, winEnd, counts[sNum]);
+			cout << "Piled up " << totalReads << " reads aligned to " << refID << ":" << winStart << "-" << winEnd << " from " << labels[sNum] << endl;
+		}
+		unsigned long long countsBytes = (unsigned long long)numSamples * pileupPlanes * thisLen * sizeof(unsigned short);
+		if(countsBytes > peakCountsBytes){
+			peakCountsBytes = countsBytes;
+		}
+		
+		// Reference base codes, N or other ref bases (code 4) let all bases count as non-reference
+		refCodes.assign(thisLen, 4);
+		for(int pos=0; pos < thisLen; pos++){
+			switch(refSeq[winStart + pos]){
+				case 'A':
+				case 'a':
+					refCodes[pos] = 0;
+					break;
+				case 'T':
+				case 't':
+					refCodes[pos] = 1;
+					break;
+				case 'C':
+				case 'c':
+					refCodes[pos] = 2;
+					break;
+				case 'G':
+				case 'g':
+					refCodes[pos] = 3;
+			}
+		}
+		
+		// Flag positions where any sample has readDepthMin of a non-reference base.  Branch-free per plane, so loops vectorise.
+		hits.assign(thisLen, 0);
+		const unsigned int depthMin = readDepthMin;
+		for(int sNum=0; sNum < numSamples; sNum++){
+			for(int baseI=0; baseI < 4; baseI++){
+				const unsigned short* plane = &counts[sNum][(size_t)baseI * thisLen];
+				const unsigned char* refCode = &refCodes[0];
+				unsigned char* hit = &hits[0];
+				for(int pos=0; pos < thisLen; pos++){
+					hit[pos] |= (unsigned char)((plane[pos] >= depthMin) & (refCode[pos] != baseI));
+				}
+			}
+		}
+		
+		vector< vector<unsigned int> > baseTally(numSamples, vector<unsigned int>(4, 0));
+		vector<unsigned int> totalReads(numSamples, 0);
+		for(int pos=0; pos < thisLen; pos++){
+			if(hits[pos]){
+				for(int sNum=0; sNum < numSamples; sNum++){
+					totalReads[sNum] = counts[sNum][(size_t)4 * thisLen + pos];
+					for(int baseI=0; baseI < 4; baseI++){
+						baseTally[sNum][baseI] = counts[sNum][(size_t)baseI * thisLen + pos];
+						totalReads[sNum] += baseTally[sNum][baseI];
+					}
+				}
+				if(reportSNP(winStart + pos, refSeq[winStart + pos], refID, baseTally, totalReads)){
+					snpPrintCount++;
+				}
+			}
+		}
+	}
+	cout << "Output SNPs at " << snpPrintCount << " coords on " << refID << endl;
+	return true;
+}
+
+/*** Stream reads for a sample from SAM file, adding base calls within winStart..winEnd to per-position counters
+** Counters are planes of window length, for A, T, C, G then other non-N calls (deletions, ambiguous bases), as counted by tallyBases.
+** Counters saturate at 65535 rather than wrapping.  Returns the number of reads counted.
  ***/
-int SNPTallyer::readReadsSample(const string& inSamFileName, string refID, vector<AlignedRead>& reads){
-	int count = 0;
+unsigned int SNPTallyer::countPileupSample(const string& inSamFileName, string refID, int winStart, int winEnd, vector<unsigned short>& counts){
+	unsigned int count = 0;
 	ifstream fileifs;
 	boost::iostreams::filtering_istream infile;
+	if(!openSamFile(inSamFileName, fileifs, infile)){
+		return 0;
+	}
+	const size_t winLen = winEnd - winStart + 1;
+	unsigned short* otherPlane = &counts[4 * winLen];
+	
+	try {
+		refID = "\t" + refID + "\t";
+		
+		vector<AlignedRead> lineReads;
+		string line;
+		while(getline(infile, line)){
+			if(line.find(refID) != string::npos){
+				lineReads.clear();
+				parseSamLine(line, lineReads);
+				bool counted = false;
+				for(int i=0; i < lineReads.size(); i++){
+					const AlignedRead& aRead = lineReads[i];
+					// Positions away from read edges, within window
+					int from = aRead.start() + edgeBuffer;
+					int to = aRead.end() - edgeBuffer;
+					if(from < winStart){
+						from = winStart;
+					}
+					if(to > winEnd){
+						to = winEnd;
+					}
+					for(int pos=from; pos <= to; pos++){
+						const unsigned char packedBase = aRead.packed(pos - aRead.start());
+						if((packedBase >> AlignedRead::qualShift) >= minBaseQual){
+							const unsigned char baseCode = packedBase & AlignedRead::baseMask;
+							if(baseCode < 4){
+								unsigned short& count = counts[baseCode * winLen + (pos - winStart)];
+								count += (count != USHRT_MAX);
+							}else if(baseCode != AlignedRead::codeN){
+								unsigned short& count = otherPlane[pos - winStart];
+								count += (count != USHRT_MAX);
+							}
+						}
+						counted = true;
+					}
+				}
+				if(counted){
+					count++;
+				}
+			}
+		}
+	}
+	catch(const boost::iostreams::gzip_error& e) {
+		cerr << "Error while reading SAM file " << inSamFileName << endl;
+		cerr << e.what() << endl;
+	}
+	fileifs.close();
+	infile.reset();
+	return count;
+}
+
+/*** Load read alignments against a reference seq, from SAM files, for all samples 
+** Reads starting within winStart..winEnd are added, earlier reads still spanning winStart are kept and the rest evicted.
+**/
+void SNPTallyer::readReadsAll(const string& refID, int winStart, int winEnd){
+	if(readsLoadedFor != refID){
+		reads.clear();
+		for(int sNum=0; sNum < numSamples; sNum++){
+			reads.push_back(vector<AlignedRead>());
+		}
+	}
+	
+	#pragma omp parallel for
+	for(int sNum=0; sNum < numSamples; sNum++){
+		// Evict reads behind the sweep
+		int keepNum = 0;
+		for(int i=0; i < reads[sNum].size(); i++){
+			if(reads[sNum][i].end() >= winStart){
+				reads[sNum][keepNum] = reads[sNum][i];
+				keepNum++;
+			}
+		}
+		reads[sNum].erase(reads[sNum].begin() + keepNum, reads[sNum].end());
+		
+		int totalReads = readReadsSample(inSAMFileNames[sNum], refID, reads[sNum], winStart, winEnd);
+		if(winStart == 0 && winEnd == INT_MAX){
+			cout << "Loaded " << totalReads << " reads aligned to " << refID << " from " << labels[sNum] << endl;
+		}else{
+			cout << "Loaded " << totalReads << " reads aligned to " << refID << ":" << winStart << "-" << winEnd << " from " << labels[sNum] << endl;
+		}
+	}
+	readsLoadedFor = refID;
+	
+	unsigned long long loadedBytes = 0;
+	for(int sNum=0; sNum < numSamples; sNum++){
+		loadedBytes += reads[sNum].capacity() * sizeof(AlignedRead);
+		for(int i=0; i < reads[sNum].size(); i++){
+			loadedBytes += reads[sNum][i].memBytes() - sizeof(AlignedRead);
+		}
+	}
+	if(loadedBytes > peakReadBytes){
+		peakReadBytes = loadedBytes;
+	}
+	return;
+}
+
+/*** Open a SAM file, .gz compressed or not, for line reading
+**/
+bool SNPTallyer::openSamFile(const string& inSamFileName, ifstream& fileifs, boost::iostreams::filtering_istream& infile){
 	bool gzipFile = false;
 	if(inSamFileName.find("gz", inSamFileName.length()-3) != string::npos || 
 			inSamFileName.find("GZ", inSamFileName.length()-3) != string::npos){
@@ -301,91 +716,38 @@ int SNPTallyer::readReadsSample(const string& inSamFileName, string refID, vecto
 		fileifs.close();
 		return false;
 	}
+	if(gzipFile){
+		infile.push(boost::iostreams::gzip_decompressor());
+	}
+	infile.push(fileifs);
+	return true;
+}
+
+/*** Load read alignments against a reference seq, from SAM files, for a single sample, adding to vector of aligned reads
+** Only aligned blocks starting within winStart..winEnd are added.
+ ***/
+int SNPTallyer::readReadsSample(const string& inSamFileName, string refID, vector<AlignedRead>& reads, int winStart, int winEnd){
+	int count = 0;
+	ifstream fileifs;
+	boost::iostreams::filtering_istream infile;
+	if(!openSamFile(inSamFileName, fileifs, infile)){
+		return 0;
+	}
 	
 	try {
-		if(gzipFile){
-			infile.push(boost::iostreams::gzip_decompressor());
-		}
-		infile.push(fileifs);
-
 		refID = "\t" + refID + "\t";
 		
+		vector<AlignedRead> lineReads;
 		string line;
 		while(getline(infile, line)){
 			// If refID in line
 			if(line.find(refID) != string::npos){
-				stringstream linestream(line);
-				vector<string> lineParts;
-				lineParts.reserve(11);
-				string aLinePart;
-				// Tab separated split
-				while(getline(linestream, aLinePart, '\t')){
-					lineParts.push_back(aLinePart);
-				}
-				if(lineParts.size() >= 11){
-					// readID == [0], refID == [2], start == [3], cigar == [5], readSeq == [9]
-					
-					// Ignore reads with Ns
-					if(lineParts[9].find("N") == string::npos){
-						
-						// Process cigar string
-						stringstream startstream(lineParts[3]);
-						int alignStart;
-						startstream >> alignStart;
-						alignStart = alignStart - 1;
-						string fixedSeq;
-						int valStartI = 0;
-						int seqPointI = 0;
-						for(int i=0; i<lineParts[5].length(); i++){
-							if(!isdigit(lineParts[5].at(i))){
-								
-								char action = lineParts[5].at(i);
-								string valuestr = lineParts[5].substr(valStartI, i-valStartI);
-								stringstream valuess(valuestr);
-								int value;
-								valuess >> value;
-								
-								switch (action){
-									case('M'):  // Match
-										fixedSeq.append(lineParts[9].substr(seqPointI,value));
-										seqPointI += value;
-										break;
-										
-									case('S'):  // Soft-trim
-										if(seqPointI == 0){
-											//alignStart += value;
-											seqPointI += value;
-										}
-										break;
-										
-									case('N'): { // Intron
-										int alignEnd = alignStart + fixedSeq.length() - 1;
-										reads.push_back(AlignedRead(fixedSeq, alignStart, alignEnd));
-										alignStart = alignEnd + 1 + value;
-										fixedSeq.clear();
-										count++;
-										}
-										break;
-										
-									case('D'):  // Del
-										for(int i=0; i<value; i++){
-											fixedSeq.push_back(' ');
-										}
-										break;
-										
-									case('I'):  // Ins
-										seqPointI += value;
-										break;
-								}
-								
-								valStartI = i+1;
-							}
-						}
-						if(!(fixedSeq.empty())){
-							int alignEnd = alignStart + fixedSeq.length() - 1;
-							reads.push_back(AlignedRead(fixedSeq, alignStart, alignEnd));
-							count++;
-						}
+				lineReads.clear();
+				parseSamLine(line, lineReads);
+				for(int i=0; i < lineReads.size(); i++){
+					if(lineReads[i].start() >= winStart && lineReads[i].start() <= winEnd){
+						reads.push_back(lineReads[i]);
+						count++;
 					}
 				}
 			}
@@ -403,8 +765,170 @@ int SNPTallyer::readReadsSample(const string& inSamFileName, string refID, vecto
 	return count;
 }
 
+/*** Counting pass over SAM file for a single sample, tallying memory needed to store aligned reads per bin of the reference seq
+ ***/
+void SNPTallyer::countReadsSample(const string& inSamFileName, string refID, vector<unsigned long long>& binBytes){
+	ifstream fileifs;
+	boost::iostreams::filtering_istream infile;
+	if(!openSamFile(inSamFileName, fileifs, infile)){
+		return;
+	}
+	
+	try {
+		refID = "\t" + refID + "\t";
+		
+		vector<AlignedRead> lineReads;
+		string line;
+		while(getline(infile, line)){
+			if(line.find(refID) != string::npos){
+				lineReads.clear();
+				parseSamLine(line, lineReads);
+				for(int i=0; i < lineReads.size(); i++){
+					int bin = lineReads[i].start() / memBinSize;
+					if(bin >= binBytes.size()){
+						bin = binBytes.size() - 1;
+					}
+					binBytes[bin] += lineReads[i].memBytes();
+				}
+			}
+		}
+	}
+	catch(const boost::iostreams::gzip_error& e) {
+		cerr << "Error while reading SAM file " << inSamFileName << endl;
+		cerr << e.what() << endl;
+	}
+	fileifs.close();
+	infile.reset();
+	return;
+}
+
+/*** Split a SAM format line into aligned blocks (a block per intron-separated segment), adding to vector of aligned reads
+** Returns number of blocks added.
+ ***/
+int SNPTallyer::parseSamLine(const string& line, vector<AlignedRead>& lineReads){
+	int count = 0;
+	stringstream linestream(line);
+	vector<string> lineParts;
+	lineParts.reserve(11);
+	string aLinePart;
+	// Tab separated split
+	while(getline(linestream, aLinePart, '\t')){
+		lineParts.push_back(aLinePart);
+	}
+	if(lineParts.size() >= 11){
+		// readID == [0], refID == [2], start == [3], mapQ == [4], cigar == [5], readSeq == [9], readQual == [10]
+		
+		if(minMapQ > 0){
+			stringstream mapQstream(lineParts[4]);
+			int mapQ = 0;
+			mapQstream >> mapQ;
+			if(mapQ < minMapQ){
+				return 0;
+			}
+		}
+		
+		// Ignore reads with Ns, unless per-base quality filtering will reject them at pileup
+		if(minBaseQual > 0 || lineParts[9].find("N") == string::npos){
+			
+			const string& readQual = lineParts[10];
+			const bool hasQual = (readQual.length() == lineParts[9].length());
+			
+			// Process cigar string
+			stringstream startstream(lineParts[3]);
+			int alignStart;
+			startstream >> alignStart;
+			alignStart = alignStart - 1;
+			string fixedSeq;
+			string fixedQual;
+			int valStartI = 0;
+			int seqPointI = 0;
+			for(int i=0; i<lineParts[5].length(); i++){
+				if(!isdigit(lineParts[5].at(i))){
+					
+					char action = lineParts[5].at(i);
+					string valuestr = lineParts[5].substr(valStartI, i-valStartI);
+					stringstream valuess(valuestr);
+					int value;
+					valuess >> value;
+					
+					switch (action){
+						case('M'):  // Match
+							fixedSeq.append(lineParts[9].substr(seqPointI,value));
+							if(hasQual){
+								fixedQual.append(readQual.substr(seqPointI,value));
+							}
+							seqPointI += value;
+							break;
+							
+						case('S'):  // Soft-trim
+							if(seqPointI == 0){
+								//alignStart += value;
+								seqPointI += value;
+							}
+							break;
+							
+						case('N'): { // Intron
+							int alignEnd = alignStart + fixedSeq.length() - 1;
+							lineReads.push_back(AlignedRead(fixedSeq, fixedQual, alignStart, alignEnd));
+							alignStart = alignEnd + 1 + value;
+							fixedSeq.clear();
+							fixedQual.clear();
+							count++;
+							}
+							break;
+							
+						case('D'):  // Del
+							for(int i=0; i<value; i++){
+								fixedSeq.push_back(' ');
+								if(hasQual){
+									fixedQual.push_back(' ');
+								}
+							}
+							break;
+							
+						case('I'):  // Ins
+							seqPointI += value;
+							break;
+					}
+					
+					valStartI = i+1;
+				}
+			}
+			if(!(fixedSeq.empty())){
+				int alignEnd = alignStart + fixedSeq.length() - 1;
+				lineReads.push_back(AlignedRead(fixedSeq, fixedQual, alignStart, alignEnd));
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
 	/*** Test reads from all samples over a SNP coord and print results if suitable **/
 bool SNPTallyer::testSNP(const unsigned int snpCoord, const char refBase, const string& refID){
+	
+	/* Base tally per sample i: 0 = A, 1 = T, 2 = C, 3 = G */
+	vector< vector<unsigned int> > baseTally;
+	vector<unsigned int> totalReads (numSamples, 0);
+	for(int sNum=0; sNum < numSamples; sNum++){
+		baseTally.push_back(vector<unsigned int>(4, 0));
+	}
+	
+	#pragma omp parallel for
+	for(int sNum=0; sNum < numSamples; sNum++){	
+		totalReads[sNum] = tallyBases(snpCoord, reads[sNum], baseTally[sNum]);
+		//cout << totalReads[sNum] << " reads over snp " << refID << " " << snpCoord << " for sample " << sNum << endl;
+	}
+	
+	return reportSNP(snpCoord, refBase, refID, baseTally, totalReads);
+}
+
+	/*** Print results for a SNP coord, given base tallies from all samples, if suitable **/
+bool SNPTallyer::reportSNP(const unsigned int snpCoord, 
+						const char refBase, 
+						const string& refID, 
+						const vector< vector<unsigned int> >& baseTally, 
+						const vector<unsigned int>& totalReads){
 	bool printed = false;
 	
 	/* Base tally per sample i: 0 = A, 1 = T, 2 = C, 3 = G */
@@ -427,18 +951,6 @@ bool SNPTallyer::testSNP(const unsigned int snpCoord, const char refBase, const
 			refBaseI = 3;
 	}
 	
-	vector< vector<unsigned int> > baseTally;
-	vector<unsigned int> totalReads (numSamples, 0);
-	for(int sNum=0; sNum < numSamples; sNum++){
-		baseTally.push_back(vector<unsigned int>(4, 0));
-	}
-	
-	#pragma omp parallel for
-	for(int sNum=0; sNum < numSamples; sNum++){	
-		totalReads[sNum] = tallyBases(snpCoord, reads[sNum], baseTally[sNum]);
-		//cout << totalReads[sNum] << " reads over snp " << refID << " " << snpCoord << " for sample " << sNum << endl;
-	}
-	
 	vector<bool> basesToPrint(4, false);
 	for(int baseI=0; baseI < 4; baseI++){
 		if(baseI != refBaseI){
@@ -550,24 +1062,17 @@ unsigned int SNPTallyer::tallyBases(const unsigned int snpCoord, const vector<Al
 			break;
 		}else if(sampReads[i].end() >= snpCoord){
 			if(sampReads[i].start()+edgeBuffer <= snpCoord && sampReads[i].end()-edgeBuffer >= snpCoord){
-				totalReads++;
 				const unsigned int readSNPCoord = snpCoord - sampReads[i].start();
-				switch(sampReads[i][readSNPCoord]){
-					case 'A':
-					case 'a':
-						baseTally[0] += 1;
-						break;
-					case 'T':
-					case 't':
-						baseTally[1] += 1;
-						break;
-					case 'C':
-					case 'c':
-						baseTally[2] += 1;
-						break;
-					case 'G':
-					case 'g':
-						baseTally[3] += 1;
+				const unsigned char packedBase = sampReads[i].packed(readSNPCoord);
+				// Reject low quality and N bases
+				if((packedBase >> AlignedRead::qualShift) >= minBaseQual){
+					const unsigned char baseCode = packedBase & AlignedRead::baseMask;
+					if(baseCode < 4){
+						baseTally[baseCode] += 1;
+						totalReads++;
+					}else if(baseCode != AlignedRead::codeN){
+						totalReads++;
+					}
 				}
 			}
 		}
@@ -30,6 +30,9 @@ class SNPTallyer {
 	static const int defaultEdgeBuffer = 5; //!< Default edgeBuffer =5
 	static const int minorAlleleThresh = 4; //!< SNP looks real if a minor allele has less than 1/n reads of SNP allele
 	static const int readEndBuffer = 500; //!< Offset reads by this when finding search start in tallyBases algorithm
+	static const int memBinSize = 100000; //!< Bin size (bp) for measuring read memory use when planning windows under a memory budget
+	static const int memBytesPerRefPos = 64; //!< Read memory assumed per reference position per sample (~45x depth of 100bp reads), below which windows aren't planned
+	static const int pileupPlanes = 5; //!< Discovery mode counter planes per sample: A, T, C, G, other non-N calls
 	
 	vector<string> inSAMFileNames; //!< List of SAM alignment files for input
 	vector<string> inSNPFileNames; //!< List of biokanga-align SNP files for input
@@ -41,9 +44,19 @@ class SNPTallyer {
 	int outFormat;  //!< Output format, 1 = row per SNP, 2 = row per allele, 3 = row per pos
 	bool filesReady;  //!< Indicates that class has been initialised, output files have been opened and SNPTallyer is ready to run
 	bool snpsPreLoaded;  //!< Indicates that biokanga-align SNP files have been parsed and snpPreList prepared
+	bool discoverMode;  //!< De novo SNP discovery over every covered position, no biokanga-align SNP files needed
 	string readsLoadedFor;	//!< Stores reference sequence ID of currently loaded read alignments
 	int readDepthMin; //!< Minimum read depth from a sample for a reported SNP 
 	int edgeBuffer; //!< In test of reads spanning SNPs, this adds an untested buffer to edge of read
+	int minMapQ; //!< Minimum SAM mapping quality for a read to be loaded
+	int minBaseQual; //!< Minimum Phred base quality for a base to be tallied (0 = no filtering, reads with Ns are dropped)
+	bool resume; //!< Resume an interrupted run, skipping reference sequences recorded as done in the checkpoint file
+	string ckptFileName; //!< Checkpoint file name, records completed reference sequences and matching output file offsets
+	ofstream ckptfile; //!< Checkpoint file, appended to as each reference sequence is completed
+	set<string> refsDone; //!< Reference sequences completed by an earlier run, as read from the checkpoint file
+	unsigned long long maxMemBytes; //!< Memory budget for loaded reads, reference seqs are processed in windows to fit (0 = no limit)
+	unsigned long long peakReadBytes; //!< Peak memory witnessed holding loaded reads
+	unsigned long long peakCountsBytes; //!< Discovery mode, peak memory witnessed holding per-position base counters
 	map< string, set<unsigned int> > snpPreList; //!< List of all starting SNP positions, as read from the biokanga-align SNP files
 	vector<vector<AlignedRead> > reads; //!< Stores details of aligned reads for a reference sequence
 	
@@ -55,24 +68,73 @@ class SNPTallyer {
 						const string& aOutTabFileName, 
 						const int aOutFormat, 
 						const int aReadDepthMin, 
-						const int aEdgeBuffer);
+						const int aEdgeBuffer, 
+						const bool aResume, 
+						const int aMaxMemMB, 
+						const int aMinMapQ, 
+						const int aMinBaseQual, 
+						const bool aDiscoverMode);
+
+		/*** Read checkpoint file of an earlier run, truncate output file back to the last completed reference sequence **/
+	bool loadCheckpoint(const string& aOutTabFileName);
+
+		/*** Record a completed reference sequence, with output file offset, to the checkpoint file **/
+	void writeCheckpoint(const string& refID);
 
 		/*** Read Biokanga-Align SNP lists to form starting list of SNP locations **/
 	bool loadSNPLists();
 
-		/*** Load read alignments against a reference seq, from SAM files, for all samples **/
-	void readReadsAll(const string& refID, int refSeqLen);
+		/*** Split a reference seq into coordinate windows whose aligned reads fit within the memory budget **/
+	void planReadWindows(const string& refID, 
+						int refSeqLen, 
+						vector<int>& windowStarts, 
+						vector<int>& windowEnds);
+
+		/*** Load read alignments against a reference seq window, from SAM files, for all samples **/
+	void readReadsAll(const string& refID, int winStart, int winEnd);
 
-		/*** Load read alignments against a reference seq, from SAM files, for a single sample, adding to vector of aligned reads **/
+		/*** Open a SAM file, .gz compressed or not, for line reading **/
+	bool openSamFile(const string& inSamFileName, 
+					ifstream& fileifs, 
+					boost::iostreams::filtering_istream& infile);
+
+		/*** Load read alignments against a reference seq window, from SAM files, for a single sample, adding to vector of aligned reads **/
 	int readReadsSample(const string& inSamFileName, 
 						string refID, 
-						vector<AlignedRead>& reads);
+						vector<AlignedRead>& reads, 
+						int winStart, 
+						int winEnd);
+
+		/*** Counting pass over SAM file for a single sample, tallying memory needed for aligned reads per bin of a reference seq **/
+	void countReadsSample(const string& inSamFileName, 
+						string refID, 
+						vector<unsigned long long>& binBytes);
+
+		/*** Split a SAM format line into aligned blocks, adding to vector of aligned reads **/
+	int parseSamLine(const string& line, vector<AlignedRead>& lineReads);
 
 		/*** Test reads from all samples over a SNP coord and print results if suitable **/
 	bool testSNP(const unsigned int snpCoord, 
 				const char refBase, 
 				const string& refID);
 
+		/*** Print results for a SNP coord, given base tallies from all samples, if suitable **/
+	bool reportSNP(const unsigned int snpCoord, 
+				const char refBase, 
+				const string& refID, 
+				const vector< vector<unsigned int> >& baseTally, 
+				const vector<unsigned int>& totalReads);
+
+		/*** Discover SNPs over every covered position of a reference seq **/
+	bool discoverSNPsOnRef(const string& refSeq, const string& refID);
+
+		/*** Stream reads for a sample from SAM file into per-position base counters over a reference seq window **/
+	unsigned int countPileupSample(const string& inSamFileName, 
+								string refID, 
+								int winStart, 
+								int winEnd, 
+								vector<unsigned short>& counts);
+
 		/*** Tally bases from reads seen over a SNP coord for a sample **/
 	unsigned int tallyBases(const unsigned int snpCoord, 
 							const vector<AlignedRead>& sampReads, 
@@ -87,7 +149,12 @@ class SNPTallyer {
 				const string& aOutTabFileName, 
 				const int aOutFormat, 
 				const int aReadDepthMin, 
-				const int aEdgeBuffer);
+				const int aEdgeBuffer, 
+				const bool aResume, 
+				const int aMaxMemMB, 
+				const int aMinMapQ, 
+				const int aMinBaseQual, 
+				const bool aDiscoverMode);
 	~SNPTallyer();
 	
 		/** Launch SNP tally across all reference sequences **/
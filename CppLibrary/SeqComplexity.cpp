@@ -0,0 +1,116 @@
+#include <vector>
+#include <string>
+#include <cstring>
+#include <stdint.h>
+#include "SeqComplexity.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+SeqComplexity::SeqComplexity(){
+	memset(baseCounts, 0, sizeof(baseCounts));
+	memset(tripletCounts, 0, sizeof(tripletCounts));
+	pairCounts.assign(65536, 0);
+	pairPhases.assign(65536, 2);
+}
+
+/*** True if a poly-N sequence: one base at least 2/3 of its length, or one 2-base repeat at least 1/3 of it (in phase)
+** A 2-base repeat is counted at its first position and every other position after it, as in the original per-pair rescans.
+**/
+bool SeqComplexity::isPolySeq(const char* seq, size_t seqLen){
+
+	const float maxSingle = seqLen * 2.0 / 3.0;
+	const float maxDuos = seqLen * 2.0 / 6.0;
+	const unsigned char* bases = (const unsigned char*)seq;
+
+	for(size_t i = 0; i < seqLen; i++){
+		baseCounts[bases[i]]++;
+		if(i > 0){
+			const uint16_t pair = (bases[i-1] << 8) | bases[i];
+			const unsigned char phase = (i - 1) & 1;
+			if(pairPhases[pair] == 2){
+				pairPhases[pair] = phase;
+				pairCounts[pair] = 1;
+				seenPairs.push_back(pair);
+			}else if(pairPhases[pair] == phase){
+				pairCounts[pair]++;
+			}
+		}
+	}
+
+	bool isPoly = false;
+	for(size_t i = 0; i < seqLen; i++){
+		if(baseCounts[bases[i]] >= maxSingle){
+			isPoly = true;
+		}
+	}
+	for(size_t i = 0; i < seenPairs.size(); i++){
+		if(pairCounts[seenPairs[i]] >= maxDuos){
+			isPoly = true;
+		}
+	}
+
+	// Reset for next call
+	for(size_t i = 0; i < seqLen; i++){
+		baseCounts[bases[i]] = 0;
+	}
+	for(size_t i = 0; i < seenPairs.size(); i++){
+		pairPhases[seenPairs[i]] = 2;
+	}
+	seenPairs.clear();
+	return isPoly;
+}
+
+bool SeqComplexity::isPolySeq(const string& seq){
+	return isPolySeq(seq.data(), seq.length());
+}
+
+/*** DUST score of a sequence: sum over triplets of c(c-1)/2, by number of triplets - 1.  Higher is less complex
+** Triplets with a base other than ACGT (any case) are not counted.  0 for sequences under 4 bases.
+**/
+double SeqComplexity::dustScore(const char* seq, size_t seqLen){
+	if(seqLen < 4){
+		return 0;
+	}
+	unsigned int triplet = 0;
+	int validBases = 0;
+	unsigned long score = 0;
+	for(size_t i = 0; i < seqLen; i++){
+		int code;
+		switch(seq[i]){
+			case 'A': case 'a': code = 0; break;
+			case 'C': case 'c': code = 1; break;
+			case 'G': case 'g': code = 2; break;
+			case 'T': case 't': code = 3; break;
+			default: code = -1;
+		}
+		if(code < 0){
+			validBases = 0;
+			continue;
+		}
+		triplet = ((triplet << 2) | code) & 63;
+		validBases++;
+		if(validBases >= 3){
+			// Adding the c-th copy of a triplet adds c-1 to the sum of c(c-1)/2
+			score += tripletCounts[triplet];
+			tripletCounts[triplet]++;
+		}
+	}
+	memset(tripletCounts, 0, sizeof(tripletCounts));
+	return (double)score / (seqLen - 3);
+}
+
+double SeqComplexity::dustScore(const string& seq){
+	return dustScore(seq.data(), seq.length());
+}
+
+/*** True if poly-N (when filterPoly) or DUST score over maxDust (when maxDust >= 0)
+**/
+bool SeqComplexity::isLowComplexity(const string& seq, const bool filterPoly, const double maxDust){
+	if(filterPoly && isPolySeq(seq)){
+		return true;
+	}
+	return (maxDust >= 0 && dustScore(seq) > maxDust);
+}
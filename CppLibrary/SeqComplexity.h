@@ -0,0 +1,35 @@
+#ifndef SEQCOMPLEXITY_H
+#define SEQCOMPLEXITY_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/*** Low-complexity tests for sequences, in one pass over a sequence and without allocating.
+** Counts are kept in the object and reset after each call, so keep one object per thread and reuse it.
+**/
+class SeqComplexity {
+	unsigned int baseCounts[256]; //!< Occurrences per character
+	vector<unsigned int> pairCounts; //!< Per 2-character pair, occurrences in phase with its first
+	vector<unsigned char> pairPhases; //!< Per pair, position parity of its first occurrence, or 2 if not seen
+	vector<uint16_t> seenPairs; //!< Pairs to reset after a call
+	unsigned int tripletCounts[64]; //!< Per ACGT triplet, for DUST score
+
+  public:
+	SeqComplexity();
+		/*** True if a poly-N sequence: one base at least 2/3 of its length, or one 2-base repeat at least 1/3 of it (in phase) **/
+	bool isPolySeq(const char* seq, size_t seqLen);
+	bool isPolySeq(const string& seq);
+		/*** DUST score of a sequence: sum over triplets of c(c-1)/2, by number of triplets - 1.  Higher is less complex **/
+	double dustScore(const char* seq, size_t seqLen);
+	double dustScore(const string& seq);
+		/*** True if poly-N (when filterPoly) or DUST score over maxDust (when maxDust >= 0) **/
+	bool isLowComplexity(const string& seq, const bool filterPoly, const double maxDust);
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include <vector>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+#include "SeqCountTable.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+const size_t SeqCountTable::arenaChunkBytes;
+
+SeqCountTable::SeqCountTable(){
+	init(1);
+}
+
+/*** Empty the table, ready for sequences with this many counts each
+**/
+void SeqCountTable::init(int aNumSamples){
+	numSamples = aNumSamples;
+	// Swapped out rather than cleared, so their memory is freed
+	vector< vector<char> >().swap(arenaChunks);
+	vector<SeqEntry>().swap(entries);
+	vector<unsigned int>().swap(counts);
+	vector<uint32_t>(1024, 0).swap(slots);
+	slotMask = 1023;
+}
+
+/*** Hash of a sequence's bytes
+** 8 bytes at a time, each word mixed in by multiply and rotate, then a final avalanche
+**/
+uint32_t SeqCountTable::hashSeq(const char* seq, size_t seqLen){
+	uint64_t hash = 0x9e3779b97f4a7c15ULL ^ seqLen;
+	size_t pos = 0;
+	for(; pos + 8 <= seqLen; pos += 8){
+		uint64_t word;
+		memcpy(&word, seq + pos, 8);
+		hash = (hash ^ word) * 0xbf58476d1ce4e5b9ULL;
+		hash = (hash << 31) | (hash >> 33);
+	}
+	if(pos < seqLen){
+		uint64_t word = 0;
+		memcpy(&word, seq + pos, seqLen - pos);
+		hash = (hash ^ word) * 0xbf58476d1ce4e5b9ULL;
+	}
+	hash ^= hash >> 31;
+	hash *= 0x94d049bb133111ebULL;
+	hash ^= hash >> 29;
+	return (uint32_t)hash;
+}
+
+/*** Copy a sequence into the arena, setting its position in entry
+**/
+void SeqCountTable::internSeq(const char* seq, size_t seqLen, SeqEntry& entry){
+	if(arenaChunks.empty() || arenaChunks.back().size() + seqLen > arenaChunks.back().capacity()){
+		arenaChunks.push_back(vector<char>());
+		arenaChunks.back().reserve(max(arenaChunkBytes, seqLen));
+	}
+	vector<char>& chunk = arenaChunks.back();
+	entry.chunkNum = arenaChunks.size() - 1;
+	entry.chunkPos = chunk.size();
+	chunk.insert(chunk.end(), seq, seq + seqLen);
+}
+
+/*** Counts for a sequence, added as all zero if not yet held
+**/
+unsigned int* SeqCountTable::insert(const char* seq, size_t seqLen){
+	return insert(seq, seqLen, hashSeq(seq, seqLen));
+}
+
+unsigned int* SeqCountTable::insert(const string& seq){
+	return insert(seq.data(), seq.length(), hashSeq(seq.data(), seq.length()));
+}
+
+/*** As insert(), with the sequence's hash from hashSeq() already known
+**/
+unsigned int* SeqCountTable::insert(const char* seq, size_t seqLen, uint32_t hash){
+	uint32_t slot = hash & slotMask;
+	while(slots[slot] != 0){
+		const uint32_t entryNum = slots[slot] - 1;
+		const SeqEntry& entry = entries[entryNum];
+		if(entry.hash == hash && entry.seqLen == seqLen && memcmp(getSeq(entryNum), seq, seqLen) == 0){
+			return &counts[(size_t)entryNum * numSamples];
+		}
+		slot = (slot + 1) & slotMask;
+	}
+
+	SeqEntry newEntry;
+	newEntry.seqLen = seqLen;
+	newEntry.hash = hash;
+	internSeq(seq, seqLen, newEntry);
+	entries.push_back(newEntry);
+	counts.resize(counts.size() + numSamples, 0);
+	slots[slot] = entries.size();
+	if(entries.size() * 100 > slots.size() * maxLoadPercent){
+		grow();
+	}
+	return &counts[(entries.size() - 1) * numSamples];
+}
+
+/*** Double table size and re-place all entries, by their stored hashes
+**/
+void SeqCountTable::grow(){
+	slots.assign(slots.size() * 2, 0);
+	slotMask = slots.size() - 1;
+	for(uint32_t entryNum = 0; entryNum < entries.size(); entryNum++){
+		uint32_t slot = entries[entryNum].hash & slotMask;
+		while(slots[slot] != 0){
+			slot = (slot + 1) & slotMask;
+		}
+		slots[slot] = entryNum + 1;
+	}
+}
+
+/*** Number of distinct sequences held
+**/
+size_t SeqCountTable::size() const{
+	return entries.size();
+}
+
+/*** Sequence of an entry, and its length
+**/
+const char* SeqCountTable::getSeq(uint32_t entryNum) const{
+	return arenaChunks[entries[entryNum].chunkNum].data() + entries[entryNum].chunkPos;
+}
+
+size_t SeqCountTable::getSeqLen(uint32_t entryNum) const{
+	return entries[entryNum].seqLen;
+}
+
+/*** Hash of an entry's sequence
+**/
+uint32_t SeqCountTable::getHash(uint32_t entryNum) const{
+	return entries[entryNum].hash;
+}
+
+/*** Counts of an entry
+**/
+const unsigned int* SeqCountTable::getCounts(uint32_t entryNum) const{
+	return &counts[(size_t)entryNum * numSamples];
+}
+
+/*** Alphabetical order of two entries, as for string comparison
+**/
+struct SeqEntryLess {
+	const SeqCountTable* table;
+	bool operator () (uint32_t entryA, uint32_t entryB) const{
+		const size_t lenA = table->getSeqLen(entryA);
+		const size_t lenB = table->getSeqLen(entryB);
+		const int cmp = memcmp(table->getSeq(entryA), table->getSeq(entryB), min(lenA, lenB));
+		if(cmp != 0){
+			return (cmp < 0);
+		}
+		return (lenA < lenB);
+	}
+};
+
+/*** List all entry numbers, in alphabetical order of their sequences
+**/
+void SeqCountTable::sortedEntries(vector<uint32_t>& sorted) const{
+	sorted.resize(entries.size());
+	for(uint32_t entryNum = 0; entryNum < entries.size(); entryNum++){
+		sorted[entryNum] = entryNum;
+	}
+	SeqEntryLess less;
+	less.table = this;
+	sort(sorted.begin(), sorted.end(), less);
+}
+
+/*** Bytes held by the table
+**/
+size_t SeqCountTable::memBytes() const{
+	size_t bytes = entries.capacity() * sizeof(SeqEntry) + counts.capacity() * sizeof(unsigned int) + slots.capacity() * sizeof(uint32_t);
+	for(size_t chunkNum = 0; chunkNum < arenaChunks.size(); chunkNum++){
+		bytes += arenaChunks[chunkNum].capacity();
+	}
+	return bytes;
+}
@@ -0,0 +1,66 @@
+#ifndef SEQCOUNTTABLE_H
+#define SEQCOUNTTABLE_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/*** Table of per-sample counts for whole sequences (eg. reads).
+** Sequences are interned once into an arena of large chunks, each distinct sequence then an entry number.
+** Open addressing with linear probing over entry numbers; counts sit in one contiguous slab, numSamples per entry.
+** Entries are held in order of first sight; sortedEntries() gives alphabetical order for output.
+**/
+class SeqCountTable {
+	struct SeqEntry {
+		uint32_t chunkNum; //!< Arena chunk holding sequence...
+		uint32_t chunkPos; //!< ...and its position there
+		uint32_t seqLen;
+		uint32_t hash;
+	};
+	static const size_t arenaChunkBytes = 16777216; //!< Sequences longer than this get a chunk of their own
+	static const int maxLoadPercent = 70; //!< Table size doubles when fuller than this
+
+	int numSamples; //!< Counts per sequence
+	vector< vector<char> > arenaChunks; //!< Sequence bytes
+	vector<SeqEntry> entries;
+	vector<unsigned int> counts; //!< numSamples counts per entry
+	vector<uint32_t> slots; //!< Entry number + 1 per slot, 0 if unused
+	uint32_t slotMask; //!< Table size - 1, table size being a power of 2
+
+		/*** Copy a sequence into the arena, setting its position in entry **/
+	void internSeq(const char* seq, size_t seqLen, SeqEntry& entry);
+		/*** Double table size and re-place all entries **/
+	void grow();
+
+  public:
+	SeqCountTable();
+		/*** Empty the table, ready for sequences with this many counts each **/
+	void init(int aNumSamples);
+		/*** Counts for a sequence, added as all zero if not yet held **/
+	unsigned int* insert(const char* seq, size_t seqLen);
+	unsigned int* insert(const string& seq);
+		/*** As insert(), with the sequence's hash from hashSeq() already known **/
+	unsigned int* insert(const char* seq, size_t seqLen, uint32_t hash);
+		/*** Hash of a sequence's bytes **/
+	static uint32_t hashSeq(const char* seq, size_t seqLen);
+		/*** Number of distinct sequences held **/
+	size_t size() const;
+		/*** Sequence of an entry, and its length **/
+	const char* getSeq(uint32_t entryNum) const;
+	size_t getSeqLen(uint32_t entryNum) const;
+		/*** Hash of an entry's sequence **/
+	uint32_t getHash(uint32_t entryNum) const;
+		/*** Counts of an entry **/
+	const unsigned int* getCounts(uint32_t entryNum) const;
+		/*** List all entry numbers, in alphabetical order of their sequences **/
+	void sortedEntries(vector<uint32_t>& sorted) const;
+		/*** Bytes held by the table **/
+	size_t memBytes() const;
+};
+
+#endif
@@ -400,9 +400,15 @@ string SeqReader::toStringSubseq(const int ssStart, const int ssEnd) const{
 /*** Returns the reverse complement of the last sequence string fetched from the file.
 **/
 string SeqReader::revComp() const{
+	return revComp(currSeq);
+}
+
+/*** Returns the reverse complement of any sequence string.
+**/
+string SeqReader::revComp(const string& seq){
 	string revSeq;
-	for(int i=currSeq.length()-1; i>=0; i--){
-		switch (currSeq[i]){
+	for(int i=seq.length()-1; i>=0; i--){
+		switch (seq[i]){
 			case 'A':
 				revSeq.push_back('T');
 				break;
@@ -60,6 +60,9 @@ class SeqReader {
 		/*** Returns the reverse complement of the last sequence string fetched from the file.
 		**/
 	string revComp() const;
+		/*** Returns the reverse complement of any sequence string.
+		**/
+	static string revComp(const string& seq);
   private:
   	bool nextSeqFastq();
   	bool nextSeqFasta();
@@ -0,0 +1,244 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <stdint.h>
+#include <unistd.h>
+#include "SeqRunSet.h"
+#include "SeqCountTable.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+const size_t SeqRunSet::maxMergeRuns;
+
+SeqRunSet::SeqRunSet(){
+	numSamples = 0;
+	runFilesMade = 0;
+}
+
+SeqRunSet::~SeqRunSet(){
+	removeRuns();
+}
+
+/*** Set up for runs in a temp directory
+**/
+void SeqRunSet::init(const string& tempDir, const int aNumSamples){
+	numSamples = aNumSamples;
+	stringstream prefixSS;
+	prefixSS << tempDir << "/seqRun." << getpid() << ".";
+	filePrefix = prefixSS.str();
+}
+
+/*** Name a new run file.  Thread-safe.
+**/
+string SeqRunSet::newRunFileName(){
+	stringstream fileNameSS;
+	#pragma omp critical(seqRunSetRuns)
+	{
+		fileNameSS << filePrefix << runFilesMade++ << ".bin";
+	}
+	return fileNameSS.str();
+}
+
+/*** Write a record to a run file
+**/
+void SeqRunSet::writeRecord(ofstream& outfile, const char* seq, const uint32_t seqLen, const uint32_t sNum, const unsigned int count){
+	outfile.write((const char*)&seqLen, sizeof(seqLen));
+	outfile.write(seq, seqLen);
+	outfile.write((const char*)&sNum, sizeof(sNum));
+	outfile.write((const char*)&count, sizeof(count));
+}
+
+/*** Write a table of one sample's counts as a sorted run.  Thread-safe.
+**/
+bool SeqRunSet::writeRun(const int sNum, const SeqCountTable& table){
+	if(table.size() == 0){
+		return true;
+	}
+	vector<uint32_t> sortedSeqs;
+	table.sortedEntries(sortedSeqs);
+
+	const string fileName = newRunFileName();
+	ofstream outfile(fileName.c_str(), ios_base::out | ios_base::binary);
+	for(size_t i = 0; i < sortedSeqs.size(); i++){
+		writeRecord(outfile, table.getSeq(sortedSeqs[i]), table.getSeqLen(sortedSeqs[i]), sNum, *table.getCounts(sortedSeqs[i]));
+	}
+	outfile.close();
+	#pragma omp critical(seqRunSetRuns)
+	{
+		runs.push_back(fileName);
+	}
+	if(!outfile){
+		cerr << "Unable to write temp file " << fileName << "!\n";
+		return false;
+	}
+	return true;
+}
+
+/*** Number of runs written
+**/
+size_t SeqRunSet::numRuns() const{
+	return runs.size();
+}
+
+/*** Open all runs, ready for nextRow(), first merging them in groups if too many
+** Each group's rows are written back as one intermediate run, until few enough runs remain to merge at once.
+**/
+bool SeqRunSet::startMerge(){
+	string seq;
+	vector< unsigned int > counts;
+	while(runs.size() > maxMergeRuns){
+		vector< string > mergedRuns;
+		for(size_t firstRun = 0; firstRun < runs.size(); firstRun += maxMergeRuns){
+			const size_t endRun = min(firstRun + maxMergeRuns, runs.size());
+			if(endRun - firstRun == 1){
+				mergedRuns.push_back(runs[firstRun]);
+				continue;
+			}
+			if(!openRuns(firstRun, endRun)){
+				return false;
+			}
+			const string fileName = newRunFileName();
+			mergedRuns.push_back(fileName);
+			ofstream outfile(fileName.c_str(), ios_base::out | ios_base::binary);
+			while(nextRow(seq, counts)){
+				for(size_t i = 0; i < rowSamples.size(); i++){
+					writeRecord(outfile, seq.data(), seq.length(), rowSamples[i], counts[rowSamples[i]]);
+				}
+			}
+			outfile.close();
+			closeRuns();
+			for(size_t runNum = firstRun; runNum < endRun; runNum++){
+				remove(runs[runNum].c_str());
+			}
+			if(!outfile){
+				cerr << "Unable to write temp file " << fileName << "!\n";
+				runs.swap(mergedRuns);
+				return false;
+			}
+		}
+		runs.swap(mergedRuns);
+	}
+	return openRuns(0, runs.size());
+}
+
+/*** Open a range of runs for merging, ready for nextRow()
+**/
+bool SeqRunSet::openRuns(const size_t firstRun, const size_t endRun){
+	closeRuns();
+	readers.assign(runs.size(), NULL);
+	for(size_t runNum = firstRun; runNum < endRun; runNum++){
+		RunReader* reader = new RunReader();
+		readers[runNum] = reader;
+		reader->fileBuffer.resize(readBufferBytes);
+		reader->infile.rdbuf()->pubsetbuf(&reader->fileBuffer[0], readBufferBytes);
+		reader->infile.open(runs[runNum].c_str(), ios_base::in | ios_base::binary);
+		if(!reader->infile.is_open()){
+			cerr << "Unable to open temp file " << runs[runNum] << "!\n";
+			return false;
+		}
+		if(readNext(runNum)){
+			heap.push_back(runNum);
+		}
+	}
+	for(size_t pos = heap.size() / 2; pos > 0; pos--){
+		siftDown(pos - 1);
+	}
+	return true;
+}
+
+/*** Close any open runs
+**/
+void SeqRunSet::closeRuns(){
+	for(size_t runNum = 0; runNum < readers.size(); runNum++){
+		delete readers[runNum];
+	}
+	readers.clear();
+	heap.clear();
+}
+
+/*** Read next record of a run into its reader, returns false at end
+**/
+bool SeqRunSet::readNext(const int runNum){
+	RunReader& reader = *readers[runNum];
+	uint32_t seqLen;
+	if(!reader.infile.read((char*)&seqLen, sizeof(seqLen))){
+		return false;
+	}
+	reader.seq.resize(seqLen);
+	if(seqLen > 0){
+		reader.infile.read(&reader.seq[0], seqLen);
+	}
+	reader.infile.read((char*)&reader.sNum, sizeof(reader.sNum));
+	reader.infile.read((char*)&reader.count, sizeof(reader.count));
+	return true;
+}
+
+/*** Restore heap order downward from a position, heap ordered by runs' current sequences
+**/
+void SeqRunSet::siftDown(size_t pos){
+	while(true){
+		size_t first = pos;
+		const size_t left = 2 * pos + 1;
+		const size_t right = left + 1;
+		if(left < heap.size() && readers[heap[left]]->seq < readers[heap[first]]->seq){
+			first = left;
+		}
+		if(right < heap.size() && readers[heap[right]]->seq < readers[heap[first]]->seq){
+			first = right;
+		}
+		if(first == pos){
+			return;
+		}
+		swap(heap[pos], heap[first]);
+		pos = first;
+	}
+}
+
+/*** Next sequence in alphabetical order with its counts per sample, returns false once all merged
+**/
+bool SeqRunSet::nextRow(string& seq, vector< unsigned int >& counts){
+	if(heap.empty()){
+		return false;
+	}
+	seq = readers[heap[0]]->seq;
+	counts.assign(numSamples, 0);
+	rowSamples.clear();
+
+	// Take every run's record for this sequence
+	while(!heap.empty()){
+		const int runNum = heap[0];
+		const RunReader& reader = *readers[runNum];
+		if(reader.seq != seq){
+			break;
+		}
+		if(counts[reader.sNum] == 0){
+			rowSamples.push_back(reader.sNum);
+		}
+		counts[reader.sNum] += reader.count;
+		if(!readNext(runNum)){
+			heap[0] = heap.back();
+			heap.pop_back();
+		}
+		if(!heap.empty()){
+			siftDown(0);
+		}
+	}
+	return true;
+}
+
+/*** Close and delete all run files
+**/
+void SeqRunSet::removeRuns(){
+	closeRuns();
+	for(size_t runNum = 0; runNum < runs.size(); runNum++){
+		remove(runs[runNum].c_str());
+	}
+	runs.clear();
+}
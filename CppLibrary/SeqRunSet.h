@@ -0,0 +1,71 @@
+#ifndef SEQRUNSET_H
+#define SEQRUNSET_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include "SeqCountTable.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/*** Set of sorted runs of sequence counts on disk, for counting sequences in bounded memory.
+** Each run holds one sample's sequences in alphabetical order with their counts; a sample may have several runs.
+** Runs are then merged with a k-way heap merge, giving each sequence's counts summed across runs, per sample, in alphabetical order.
+** Beyond maxMergeRuns, runs are first merged in groups into intermediate runs, so the number of open files and read buffers stays bounded.
+** Run records: length (4 bytes), sequence, sample number (4 bytes), count (4 bytes).
+**/
+class SeqRunSet {
+	struct RunReader {
+		ifstream infile;
+		vector<char> fileBuffer;
+		string seq; //!< Current record...
+		uint32_t sNum;
+		unsigned int count;
+	};
+	static const size_t readBufferBytes = 262144; //!< Read buffer per run when merging
+	static const size_t maxMergeRuns = 64; //!< Most runs open at once when merging
+
+	string filePrefix; //!< Start of run file names, unique to this process
+	int numSamples;
+	int runFilesMade; //!< Run files named so far, numbering the next
+	vector< string > runs; //!< Run file names
+	vector< RunReader* > readers; //!< One per run while merging, NULL for runs not open
+	vector< int > heap; //!< Run numbers, as a heap on their current records
+	vector< int > rowSamples; //!< Samples with a count in the last row
+
+		/*** Name a new run file.  Thread-safe. **/
+	string newRunFileName();
+		/*** Write a record to a run file **/
+	void writeRecord(ofstream& outfile, const char* seq, const uint32_t seqLen, const uint32_t sNum, const unsigned int count);
+		/*** Open a range of runs for merging, ready for nextRow() **/
+	bool openRuns(const size_t firstRun, const size_t endRun);
+		/*** Close any open runs **/
+	void closeRuns();
+		/*** Read next record of a run into its reader, returns false at end **/
+	bool readNext(const int runNum);
+		/*** Restore heap order downward from a position **/
+	void siftDown(size_t pos);
+
+  public:
+	SeqRunSet();
+		/*** Set up for runs in a temp directory **/
+	void init(const string& tempDir, const int aNumSamples);
+		/*** Write a table of one sample's counts as a sorted run.  Thread-safe. **/
+	bool writeRun(const int sNum, const SeqCountTable& table);
+		/*** Number of runs written **/
+	size_t numRuns() const;
+		/*** Open all runs, ready for nextRow(), first merging them in groups if too many **/
+	bool startMerge();
+		/*** Next sequence in alphabetical order with its counts per sample, returns false once all merged **/
+	bool nextRow(string& seq, vector< unsigned int >& counts);
+		/*** Close and delete all run files **/
+	void removeRuns();
+	~SeqRunSet();
+};
+
+#endif
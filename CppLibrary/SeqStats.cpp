@@ -0,0 +1,250 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <utility>
+#include <sys/stat.h>
+#include "SeqReader.h"
+#include "SeqStats.h"
+#include "SeqStatsReport.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+SeqStats::SeqStats(){
+	init(0, 1);
+}
+
+/*** Empty the stats, ready to keep these metrics
+**/
+void SeqStats::init(const int aMetrics, const int aProfileEvery){
+	metrics = aMetrics;
+	profileEvery = aProfileEvery;
+	profileCounter = profileEvery - 1;
+	numSeqs = 0;
+	totalLen = 0;
+	minLen = -1;
+	maxLen = -1;
+	minId = "";
+	maxId = "";
+	lengths.clear();
+	numProfiled = 0;
+	sumGCs = 0;
+	sumQuals = 0;
+	sumMidQuals = 0;
+	sumEndQuals = 0;
+	positionQualSums.clear();
+	positionQualCounts.clear();
+	for(int base = 0; base < BaseComposition::numBaseTypes; base++){
+		fileBaseCounts[base] = 0;
+		seqBaseCounts[base] = 0;
+	}
+}
+
+/*** Gather stats for each file in one pass, kept as the reports need, then have each report write
+** Files are read in parallel over OMP_NUM_THREADS threads, largest first, unless a report takes sequences as they are read.
+**/
+void SeqStats::runReports(const vector<string>& fileNames, const vector<SeqStatsReport*>& reports, const int profileEvery, vector<SeqStats>& fileStats){
+	int allMetrics = 0;
+	bool inOrder = false;
+	for(size_t i = 0; i < reports.size(); i++){
+		allMetrics |= reports[i]->metrics();
+		inOrder = inOrder || reports[i]->takesSeqs();
+	}
+	const int numFiles = fileNames.size();
+	fileStats.resize(numFiles);
+
+	vector< pair<off_t, int> > fileOrder;
+	for(int fileNum = 0; fileNum < numFiles; fileNum++){
+		struct stat fileInfo;
+		const off_t fileSize = (stat(fileNames[fileNum].c_str(), &fileInfo) == 0) ? fileInfo.st_size : 0;
+		fileOrder.push_back(make_pair(inOrder ? 0 : -fileSize, fileNum));
+	}
+	sort(fileOrder.begin(), fileOrder.end());
+
+	#pragma omp parallel for schedule(dynamic) if(!inOrder)
+	for(int i = 0; i < numFiles; i++){
+		const int fileNum = fileOrder[i].second;
+		fileStats[fileNum].init(allMetrics, profileEvery);
+		fileStats[fileNum].readFile(fileNames[fileNum], reports);
+	}
+	for(size_t i = 0; i < reports.size(); i++){
+		reports[i]->write(fileNames, fileStats);
+	}
+}
+
+/*** Read a whole file into the stats, passing each sequence on to reports as it is read
+**/
+void SeqStats::readFile(const string& fileName, const vector<SeqStatsReport*>& reports){
+	SeqReader inFile(fileName);
+
+	#pragma omp critical
+	cerr << "Processing " << fileName << "\n";
+
+	while(inFile.nextSeq()){
+		addSeq(inFile);
+		for(size_t i = 0; i < reports.size(); i++){
+			reports[i]->addSeq(inFile, *this);
+		}
+	}
+}
+
+/*** Add one sequence
+**/
+void SeqStats::addSeq(const SeqReader& inFile){
+	const int len = inFile.getSeqLen();
+	numSeqs++;
+	totalLen += len;
+
+	if(metrics & (lengthStats | lengthChart)){
+		lengths.add(len);
+	}
+	if(metrics & lengthStats){
+		if(len < minLen || minLen == -1){
+			minLen = len;
+			minId = inFile.getSeqID();
+		}
+		if(len > maxLen || maxLen == -1){
+			maxLen = len;
+			maxId = inFile.getSeqID();
+		}
+	}
+
+	bool profile = false;
+	if(metrics & qcProfile){
+		profileCounter++;
+		if(profileCounter == profileEvery){
+			profileCounter = 0;
+			profile = true;
+		}
+	}
+	if(!profile && !(metrics & (positionQuals | baseComposition))){
+		return;
+	}
+
+	const string seq = inFile.getSeq();
+	if(profile || (metrics & baseComposition)){
+		BaseComposition::countBases(seq.data(), seq.length(), seqBaseCounts);
+		if(metrics & baseComposition){
+			for(int base = 0; base < BaseComposition::numBaseTypes; base++){
+				fileBaseCounts[base] += seqBaseCounts[base];
+			}
+		}
+	}
+
+	const string qual = inFile.getSeqQual();
+	if(profile){
+		numProfiled++;
+		sumGCs += (seqBaseCounts[BaseComposition::baseC] + seqBaseCounts[BaseComposition::baseG]) / (long double)seq.length() * 100.0;
+		if(qual.length() > 0){
+			int qualTot = 0;
+			for(size_t i = 0; i < qual.length(); i++){
+				qualTot += int(qual[i]) - 33;
+			}
+			sumQuals += qualTot / (long double)qual.length();
+			sumEndQuals += int(qual[qual.length()-1]) - 33;
+			sumMidQuals += int(qual[int(qual.length()/2)]) - 33;
+		}else{
+			sumQuals += 40;
+			sumMidQuals += 40;
+			sumEndQuals += 40;
+		}
+	}
+
+	if(metrics & positionQuals){
+		if(qual.length() > positionQualSums.size()){
+			positionQualSums.resize(qual.length(), 0);
+			positionQualCounts.resize(qual.length(), 0);
+		}
+		for(size_t i = 0; i < qual.length(); i++){
+			positionQualSums[i] += int(qual[i]) - 33;
+			positionQualCounts[i]++;
+		}
+	}
+}
+
+unsigned long SeqStats::getNumSeqs() const{
+	return numSeqs;
+}
+
+unsigned long long SeqStats::getTotalLen() const{
+	return totalLen;
+}
+
+unsigned int SeqStats::getMinLen() const{
+	return minLen;
+}
+
+unsigned int SeqStats::getMaxLen() const{
+	return maxLen;
+}
+
+const string& SeqStats::getMinId() const{
+	return minId;
+}
+
+const string& SeqStats::getMaxId() const{
+	return maxId;
+}
+
+double SeqStats::getAvLen() const{
+	return totalLen / (long double)numSeqs;
+}
+
+unsigned int SeqStats::getMedianLen() const{
+	return lengths.median();
+}
+
+unsigned int SeqStats::getN50Len() const{
+	return lengths.n50();
+}
+
+/*** Number of sequences of a length
+**/
+unsigned long SeqStats::getLengthCount(const size_t len) const{
+	return lengths.count(len);
+}
+
+/*** One past the longest length counted
+**/
+size_t SeqStats::getLengthChartSize() const{
+	return lengths.size();
+}
+
+double SeqStats::getAvGC() const{
+	return sumGCs / (long double)numProfiled;
+}
+
+double SeqStats::getAvQual() const{
+	return sumQuals / (long double)numProfiled;
+}
+
+double SeqStats::getAvMidQual() const{
+	return sumMidQuals / (long double)numProfiled;
+}
+
+double SeqStats::getAvEndQual() const{
+	return sumEndQuals / (long double)numProfiled;
+}
+
+/*** Mean quality at a read position (from 0)
+**/
+double SeqStats::getPositionQual(const size_t pos) const{
+	return positionQualSums[pos] / (long double)positionQualCounts[pos];
+}
+
+/*** One past the last position with qualities
+**/
+size_t SeqStats::getNumPositions() const{
+	return positionQualSums.size();
+}
+
+unsigned long long SeqStats::getFileBaseCount(const BaseComposition::Base base) const{
+	return fileBaseCounts[base];
+}
+
+unsigned int SeqStats::getSeqBaseCount(const BaseComposition::Base base) const{
+	return seqBaseCounts[base];
+}
@@ -0,0 +1,86 @@
+#ifndef SEQSTATS_H
+#define SEQSTATS_H
+
+#include <vector>
+#include <string>
+#include "SeqReader.h"
+#include "LengthHistogram.h"
+#include "BaseComposition.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+class SeqStatsReport;
+
+/*** Statistics of one sequence file, gathered in a single pass.
+** Only the metrics asked for are kept, so each tool pays for what it reports.
+** Reports (see SeqStatsReport) then write them in each tool's format, or take each sequence as it is read.
+**/
+class SeqStats {
+  public:
+	static const int lengthStats = 1; //!< Metrics: count, total, min/max (with IDs), median and N50 length...
+	static const int lengthChart = 2; //!< Number of sequences per length
+	static const int qcProfile = 4; //!< GC% and mean/mid/end quality, averaged over every profileEvery'th sequence
+	static const int positionQuals = 8; //!< Mean quality per read position
+	static const int baseComposition = 16; //!< A/C/G/T/N/other counts, per file and for the current sequence
+
+  private:
+	int metrics; //!< Sum of metrics kept
+	int profileEvery; //!< qcProfile sampling...
+	int profileCounter;
+	unsigned long numSeqs;
+	unsigned long long totalLen;
+	unsigned int minLen; //!< -1 until a sequence is seen...
+	unsigned int maxLen;
+	string minId; //!< First sequence of min length...
+	string maxId; //!< ...and of max length
+	LengthHistogram lengths; //!< Sequences per length, for median, N50 and length chart
+	unsigned long numProfiled;
+	long double sumGCs; //!< Of each profiled sequence's GC%...
+	long double sumQuals; //!< ...mean quality...
+	unsigned long long sumMidQuals; //!< ...quality at its middle...
+	unsigned long long sumEndQuals; //!< ...and at its end
+	vector<unsigned long long> positionQualSums; //!< Per position (from 0), sum of qualities...
+	vector<unsigned long> positionQualCounts; //!< ...over this many reads
+	unsigned long long fileBaseCounts[BaseComposition::numBaseTypes];
+	unsigned int seqBaseCounts[BaseComposition::numBaseTypes]; //!< Of the current sequence
+
+  public:
+	SeqStats();
+		/*** Empty the stats, ready to keep these metrics **/
+	void init(const int aMetrics, const int aProfileEvery);
+		/*** Gather stats for each file in one pass (files in parallel), kept as the reports need, then have each report write **/
+	static void runReports(const vector<string>& fileNames, const vector<SeqStatsReport*>& reports, const int profileEvery, vector<SeqStats>& fileStats);
+		/*** Read a whole file into the stats, passing each sequence on to reports as it is read **/
+	void readFile(const string& fileName, const vector<SeqStatsReport*>& reports);
+		/*** Add one sequence **/
+	void addSeq(const SeqReader& inFile);
+
+	unsigned long getNumSeqs() const;
+	unsigned long long getTotalLen() const;
+	unsigned int getMinLen() const;
+	unsigned int getMaxLen() const;
+	const string& getMinId() const;
+	const string& getMaxId() const;
+	double getAvLen() const;
+	unsigned int getMedianLen() const;
+	unsigned int getN50Len() const;
+		/*** Number of sequences of a length, and one past the longest length counted **/
+	unsigned long getLengthCount(const size_t len) const;
+	size_t getLengthChartSize() const;
+		/*** Averages over profiled sequences, a sequence without qualities scoring 40 **/
+	double getAvGC() const;
+	double getAvQual() const;
+	double getAvMidQual() const;
+	double getAvEndQual() const;
+		/*** Mean quality at a read position (from 0), and one past the last position with qualities **/
+	double getPositionQual(const size_t pos) const;
+	size_t getNumPositions() const;
+		/*** Count of a base type, over the file or in the current sequence **/
+	unsigned long long getFileBaseCount(const BaseComposition::Base base) const;
+	unsigned int getSeqBaseCount(const BaseComposition::Base base) const;
+};
+
+#endif
@@ -0,0 +1,219 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include "SeqReader.h"
+#include "SeqStats.h"
+#include "BaseComposition.h"
+#include "SeqStatsReport.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+int SizeStatsReport::metrics() const{
+	return SeqStats::lengthStats;
+}
+
+void SizeStatsReport::write(const vector<string>& fileNames, const vector<SeqStats>& fileStats){
+	const int numSamples = fileNames.size();
+	for(int i = 0; i < numSamples; i++){
+		out << "\t" << fileNames[i];
+	}
+	out << "\nNumber of sequences";
+	for(int i = 0; i < numSamples; i++){
+		out << "\t" << fileStats[i].getNumSeqs();
+	}
+	out << "\nCombined length";
+	for(int i = 0; i < numSamples; i++){
+		out << "\t" << fileStats[i].getTotalLen();
+	}
+	out << "\nMinimum sequence length";
+	for(int i = 0; i < numSamples; i++){
+		out << "\t" << fileStats[i].getMinLen();
+	}
+	if(numSamples == 1){
+		out << "\t(" << fileStats[0].getMinId() << ")";
+	}
+	out << "\nAverage sequence length";
+	for(int i = 0; i < numSamples; i++){
+		out << "\t" << fileStats[i].getAvLen();
+	}
+	out << "\nMedian sequence length";
+	for(int i = 0; i < numSamples; i++){
+		out << "\t" << fileStats[i].getMedianLen();
+	}
+	out << "\nN50 sequence length";
+	for(int i = 0; i < numSamples; i++){
+		out << "\t" << fileStats[i].getN50Len();
+	}
+	out << "\nMaximum sequence length";
+	for(int i = 0; i < numSamples; i++){
+		out << "\t" << fileStats[i].getMaxLen();
+	}
+	if(numSamples == 1){
+		out << "\t(" << fileStats[0].getMaxId() << ")";
+	}
+	out << "\n";
+}
+
+int SizeStatsTableReport::metrics() const{
+	return SeqStats::lengthStats;
+}
+
+void SizeStatsTableReport::write(const vector<string>& fileNames, const vector<SeqStats>& fileStats){
+	out << "File";
+	out << "\tNumSeqs";
+	out << "\tTot.Length";
+	out << "\tMin.Length";
+	out << "\tAv.Length";
+	out << "\tMedian.Length";
+	out << "\tN50.Length";
+	out << "\tMax.Length";
+	out << "\n";
+
+	for(int i = 0; i < fileNames.size(); i++){
+		out << fileNames[i];
+		out << "\t" << fileStats[i].getNumSeqs();
+		out << "\t" << fileStats[i].getTotalLen();
+		out << "\t" << fileStats[i].getMinLen();
+		out << "\t" << fileStats[i].getAvLen();
+		out << "\t" << fileStats[i].getMedianLen();
+		out << "\t" << fileStats[i].getN50Len();
+		out << "\t" << fileStats[i].getMaxLen();
+		out << "\n";
+	}
+	out << "\n";
+}
+
+int QCStatsReport::metrics() const{
+	return SeqStats::qcProfile;
+}
+
+void QCStatsReport::write(const vector<string>& fileNames, const vector<SeqStats>& fileStats){
+	out.setf(ios::fixed);
+	out << setprecision(2);
+
+	out << "\tNumSeqs\tAvLen\tTotLen\tAvQual\tAvMidQual\tAvEndQual\tAvGC\n";
+	for(int i = 0; i < fileNames.size(); i++){
+		out << fileNames[i];
+		out << "\t" << fileStats[i].getNumSeqs();
+		out << "\t" << fileStats[i].getAvLen();
+		out << "\t" << fileStats[i].getTotalLen();
+		out << "\t" << fileStats[i].getAvQual();
+		out << "\t" << fileStats[i].getAvMidQual();
+		out << "\t" << fileStats[i].getAvEndQual();
+		out << "\t" << fileStats[i].getAvGC() << "%";
+		out << "\n";
+	}
+}
+
+int SizeChartReport::metrics() const{
+	return SeqStats::lengthChart;
+}
+
+/*** Rows from length 0 to the longest in any file
+**/
+void SizeChartReport::write(const vector<string>& fileNames, const vector<SeqStats>& fileStats){
+	const int numSamples = fileNames.size();
+	size_t chartSize = 1;
+	for(int fileNum = 0; fileNum < numSamples; fileNum++){
+		if(fileStats[fileNum].getLengthChartSize() > chartSize){
+			chartSize = fileStats[fileNum].getLengthChartSize();
+		}
+	}
+
+	out << "Size";
+	for(int fileNum = 0; fileNum < numSamples; fileNum++){
+		out << "\t" << fileNames[fileNum];
+	}
+	out << "\n";
+	for(size_t len = 0; len < chartSize; len++){
+		out << len;
+		for(int fileNum = 0; fileNum < numSamples; fileNum++){
+			out << "\t" << fileStats[fileNum].getLengthCount(len);
+		}
+		out << "\n";
+	}
+	out << "\n";
+}
+
+CGStatsReport::CGStatsReport(ostream& aOut) : SeqStatsReport(aOut) {
+	out << "ID\tLength\tCG%\tA\tT\tC\tG\n";
+}
+
+int CGStatsReport::metrics() const{
+	return SeqStats::baseComposition;
+}
+
+void CGStatsReport::addSeq(const SeqReader& inFile, const SeqStats& stats){
+	out << inFile.getSeqID() << "\t" << inFile.getSeqLen() << "\t";
+
+	const unsigned int cCount = stats.getSeqBaseCount(BaseComposition::baseC);
+	const unsigned int gCount = stats.getSeqBaseCount(BaseComposition::baseG);
+	double cgPC = (cCount+gCount) / (double)inFile.getSeqLen() * 100.00;
+	out.setf(ios::fixed);
+	out << setprecision(2) << cgPC << "\t";
+	out << stats.getSeqBaseCount(BaseComposition::baseA) << "\t";
+	out << stats.getSeqBaseCount(BaseComposition::baseT) << "\t";
+	out << cCount << "\t";
+	out << gCount << "\n";
+}
+
+int BaseCompositionReport::metrics() const{
+	return SeqStats::baseComposition;
+}
+
+void BaseCompositionReport::write(const vector<string>& fileNames, const vector<SeqStats>& fileStats){
+	out.setf(ios::fixed);
+	out << setprecision(2);
+
+	out << "File\tA\tC\tG\tT\tN\tOther\tGC%\n";
+	for(int i = 0; i < fileNames.size(); i++){
+		unsigned long long totBases = 0;
+		out << fileNames[i];
+		for(int base = 0; base < BaseComposition::numBaseTypes; base++){
+			out << "\t" << fileStats[i].getFileBaseCount((BaseComposition::Base)base);
+			totBases += fileStats[i].getFileBaseCount((BaseComposition::Base)base);
+		}
+		const unsigned long long gcBases = fileStats[i].getFileBaseCount(BaseComposition::baseC) + fileStats[i].getFileBaseCount(BaseComposition::baseG);
+		out << "\t" << gcBases / (long double)totBases * 100.0;
+		out << "\n";
+	}
+}
+
+int PositionQualReport::metrics() const{
+	return SeqStats::positionQuals;
+}
+
+/*** Positions from 1; NA where a file has no reads that long
+**/
+void PositionQualReport::write(const vector<string>& fileNames, const vector<SeqStats>& fileStats){
+	const int numSamples = fileNames.size();
+	size_t numPositions = 0;
+	for(int fileNum = 0; fileNum < numSamples; fileNum++){
+		if(fileStats[fileNum].getNumPositions() > numPositions){
+			numPositions = fileStats[fileNum].getNumPositions();
+		}
+	}
+
+	out.setf(ios::fixed);
+	out << setprecision(2);
+	out << "Position";
+	for(int fileNum = 0; fileNum < numSamples; fileNum++){
+		out << "\t" << fileNames[fileNum];
+	}
+	out << "\n";
+	for(size_t pos = 0; pos < numPositions; pos++){
+		out << pos + 1;
+		for(int fileNum = 0; fileNum < numSamples; fileNum++){
+			if(pos < fileStats[fileNum].getNumPositions()){
+				out << "\t" << fileStats[fileNum].getPositionQual(pos);
+			}else{
+				out << "\tNA";
+			}
+		}
+		out << "\n";
+	}
+}
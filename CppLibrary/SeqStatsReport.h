@@ -0,0 +1,100 @@
+#ifndef SEQSTATSREPORT_H
+#define SEQSTATSREPORT_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include "SeqReader.h"
+#include "SeqStats.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/*** A report written from SeqStats, to its own output stream.
+** Says which metrics it needs kept; may take each sequence as it is read, and writes once all files are read.
+** Files may be read in parallel, so write() is the place for output unless takesSeqs().
+**/
+class SeqStatsReport {
+  protected:
+	ostream& out;
+
+  public:
+	SeqStatsReport(ostream& aOut) : out(aOut) {}
+	virtual ~SeqStatsReport(){}
+		/*** Metrics (see SeqStats) this report needs kept **/
+	virtual int metrics() const = 0;
+		/*** True if the report takes sequences as they are read, so files must be read one at a time, in order **/
+	virtual bool takesSeqs() const{ return false; }
+		/*** Take a sequence as it is read, after it is added to its file's stats **/
+	virtual void addSeq(const SeqReader&, const SeqStats&){}
+		/*** Write the report for all files **/
+	virtual void write(const vector<string>&, const vector<SeqStats>&){}
+};
+
+/*** Length stats, a row per stat and a column per file (getSeqSizeStats)
+**/
+class SizeStatsReport : public SeqStatsReport {
+  public:
+	SizeStatsReport(ostream& aOut) : SeqStatsReport(aOut) {}
+	int metrics() const;
+	void write(const vector<string>& fileNames, const vector<SeqStats>& fileStats);
+};
+
+/*** Length stats, a row per file (getSeqSizeStatsT)
+**/
+class SizeStatsTableReport : public SeqStatsReport {
+  public:
+	SizeStatsTableReport(ostream& aOut) : SeqStatsReport(aOut) {}
+	int metrics() const;
+	void write(const vector<string>& fileNames, const vector<SeqStats>& fileStats);
+};
+
+/*** Count, length, mean qualities and GC%, a row per file (getSeqQCStats)
+**/
+class QCStatsReport : public SeqStatsReport {
+  public:
+	QCStatsReport(ostream& aOut) : SeqStatsReport(aOut) {}
+	int metrics() const;
+	void write(const vector<string>& fileNames, const vector<SeqStats>& fileStats);
+};
+
+/*** Sequences per length, a row per length and a column per file (getSeqSizeChart)
+**/
+class SizeChartReport : public SeqStatsReport {
+  public:
+	SizeChartReport(ostream& aOut) : SeqStatsReport(aOut) {}
+	int metrics() const;
+	void write(const vector<string>& fileNames, const vector<SeqStats>& fileStats);
+};
+
+/*** Length, GC% and base counts, a row per sequence as read (getSeqCGstats)
+**/
+class CGStatsReport : public SeqStatsReport {
+  public:
+	CGStatsReport(ostream& aOut);
+	int metrics() const;
+	bool takesSeqs() const{ return true; }
+	void addSeq(const SeqReader& inFile, const SeqStats& stats);
+};
+
+/*** Base counts (A/C/G/T/N/other) and GC%, a row per file
+**/
+class BaseCompositionReport : public SeqStatsReport {
+  public:
+	BaseCompositionReport(ostream& aOut) : SeqStatsReport(aOut) {}
+	int metrics() const;
+	void write(const vector<string>& fileNames, const vector<SeqStats>& fileStats);
+};
+
+/*** Mean quality, a row per read position and a column per file
+**/
+class PositionQualReport : public SeqStatsReport {
+  public:
+	PositionQualReport(ostream& aOut) : SeqStatsReport(aOut) {}
+	int metrics() const;
+	void write(const vector<string>& fileNames, const vector<SeqStats>& fileStats);
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include "BaseComposition.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/** Benchmark of base counting, as done per sequence by getSeqCGstats, getSeqQCStats and getSeqStats.
+** Compares the former per-character switch against BaseComposition's table lookup and AVX2 kernels,
+** checking all give the same counts and reporting MB/s.
+** Sequences are pseudo-random, mostly upper-case ACGT with some lower-case, N and IUPAC codes.
+** Build: g++ -O2 -o benchBaseComposition benchBaseComposition.cpp BaseComposition.cpp
+**/
+
+const char progName[] = "benchBaseComposition";
+
+/*** Count as the former tools did, with N and other codes together as other
+**/
+void countBasesSwitch(const string& seq, unsigned int baseCounts[BaseComposition::numBaseTypes]){
+	for(int base = 0; base < BaseComposition::numBaseTypes; base++){
+		baseCounts[base] = 0;
+	}
+	for(int i=0; i<seq.length(); i++){
+		switch (seq[i]){
+			case 'A':
+			case 'a':
+				baseCounts[BaseComposition::baseA]++;
+				break;
+			case 'T':
+			case 't':
+				baseCounts[BaseComposition::baseT]++;
+				break;
+			case 'C':
+			case 'c':
+				baseCounts[BaseComposition::baseC]++;
+				break;
+			case 'G':
+			case 'g':
+				baseCounts[BaseComposition::baseG]++;
+				break;
+			default:
+				baseCounts[BaseComposition::baseOther]++;
+		}
+	}
+}
+
+int main(int argc,char *argv[]){
+
+	long totalMB = 256;
+	int seqLen = 10000;
+	if(argc > 1){
+		totalMB = atol(argv[1]);
+	}
+	if(argc > 2){
+		seqLen = atoi(argv[2]);
+	}
+	if(argc > 3 || totalMB < 1 || seqLen < 1){
+		cerr << "\t***** " << progName << " *****\n";
+		cerr << "Command line usage:\n" << argv[0] << " [total MB (256)] [sequence length (10000)]\n";
+		return 1;
+	}
+	const long numSeqs = totalMB * 1048576 / seqLen + 1;
+	const string someBases = "ACGTACGTACGTACGTACGTACGTACGTacgtNnRY";
+	srand(83);
+	vector<string> seqs(numSeqs, string(seqLen, 'A'));
+	for(long s = 0; s < numSeqs; s++){
+		for(int i = 0; i < seqLen; i++){
+			seqs[s][i] = someBases[rand() % someBases.length()];
+		}
+	}
+	cout << "Counting bases of " << numSeqs << " sequences of " << seqLen << " bp";
+	cout << (BaseComposition::hasAVX2() ? " (AVX2 available)" : " (no AVX2)") << endl;
+
+	vector<unsigned long long> expected(BaseComposition::numBaseTypes, 0);
+	const char* kernelNames[3] = {"switch", "table", "AVX2"};
+	for(int kernel = 0; kernel < 3; kernel++){
+		if(kernel == 2 && !BaseComposition::hasAVX2()){
+			continue;
+		}
+		vector<unsigned long long> totals(BaseComposition::numBaseTypes, 0);
+		unsigned int baseCounts[BaseComposition::numBaseTypes];
+		clock_t startTime = clock();
+		for(long s = 0; s < numSeqs; s++){
+			if(kernel == 0){
+				countBasesSwitch(seqs[s], baseCounts);
+			}else if(kernel == 1){
+				BaseComposition::countBasesScalar(seqs[s].data(), seqs[s].length(), baseCounts);
+			}else{
+				BaseComposition::countBasesAVX2(seqs[s].data(), seqs[s].length(), baseCounts);
+			}
+			for(int base = 0; base < BaseComposition::numBaseTypes; base++){
+				totals[base] += baseCounts[base];
+			}
+		}
+		double secs = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+		cout << kernelNames[kernel] << ":\t" << secs << " s, " << (numSeqs * (double)seqLen / 1048576) / secs << " MB/s";
+		if(kernel == 0){
+			// Former count had N in with other
+			expected = totals;
+		}else{
+			bool same = true;
+			for(int base = 0; base < BaseComposition::numBaseTypes; base++){
+				if(base == BaseComposition::baseOther){
+					same = same && (totals[base] + totals[BaseComposition::baseN] == expected[base]);
+				}else if(base != BaseComposition::baseN){
+					same = same && (totals[base] == expected[base]);
+				}
+			}
+			cout << (same ? ", counts match" : ", COUNTS DIFFER");
+		}
+		cout << endl;
+	}
+	return 0;
+}
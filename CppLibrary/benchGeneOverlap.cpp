@@ -0,0 +1,163 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include "IntervalIndex.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/** Benchmark of gene overlap queries, as made per read by tallyGeneCoverageSamGZ.
+** Compares the former sorted-start search (binary search on start + longest gene, then scan)
+** against IntervalIndex, visiting hits in place and gathering them into a list per read, over a GTF-sized feature set on one chromosome-sized reference that includes some megabase-long features.
+** Reads are queried in coordinate order, as from a sorted SAM file, unless 'random' is given.
+** Build: g++ -O2 -o benchGeneOverlap benchGeneOverlap.cpp IntervalIndex.cpp
+**/
+
+const char progName[] = "benchGeneOverlap";
+
+struct HitCounter {
+	unsigned long long hits;
+	HitCounter(){
+		hits = 0;
+	}
+	void operator()(const int){
+		hits++;
+	}
+}; //!< Visitor counting overlaps, as the sorted-start scan does
+
+struct BenchGene {
+	unsigned int start;
+	unsigned int end; //!< Exclusive
+	bool operator < (const BenchGene& other) const{
+		return (start < other.start);
+	}
+};
+
+unsigned int randRange(unsigned int maxVal){
+	return (unsigned int)(((unsigned long long)rand() * (RAND_MAX + 1ULL) + rand()) % maxVal);
+}
+
+int main(int argc,char *argv[]){
+	
+	int numGenes = 250000;
+	int numLongGenes = 20;
+	int numReads = 2000000;
+	bool sortedReads = true;
+	unsigned int refLen = 250000000;
+	if(argc > 1){
+		numGenes = atoi(argv[1]);
+	}
+	if(argc > 2){
+		numLongGenes = atoi(argv[2]);
+	}
+	if(argc > 3){
+		numReads = atoi(argv[3]);
+	}
+	if(argc > 4){
+		sortedReads = (string(argv[4]) != "random");
+	}
+	if(argc > 5 || numGenes < 1 || numReads < 1){
+		cerr << "\t***** " << progName << " *****\n";
+		cerr << "Command line usage:\n" << argv[0] << " [num features (250000)] [num megabase features (20)] [num reads (2000000)] [sorted/random]\n";
+		return 1;
+	}
+	
+	srand(1);
+	vector<BenchGene> genes;
+	unsigned int maxGene = 0;
+	for(int i=0; i < numGenes; i++){
+		BenchGene gene;
+		gene.start = randRange(refLen);
+		unsigned int len = 200 + randRange(20000);
+		if(i < numLongGenes){
+			len = 1000000 + randRange(2000000);
+		}
+		gene.end = gene.start + len;
+		if(len > maxGene){
+			maxGene = len;
+		}
+		genes.push_back(gene);
+	}
+	sort(genes.begin(), genes.end());
+	
+	vector<unsigned int> readStarts(numReads);
+	for(int i=0; i < numReads; i++){
+		readStarts[i] = randRange(refLen);
+	}
+	if(sortedReads){
+		sort(readStarts.begin(), readStarts.end());
+	}
+	const unsigned int readLen = 150;
+	
+	// Former search: binary search on start + longest gene, then scan forward
+	clock_t t0 = clock();
+	unsigned long long scanHits = 0;
+	unsigned long long scanVisited = 0;
+	for(int r=0; r < numReads; r++){
+		const unsigned int rStart = readStarts[r];
+		const unsigned int rEnd = rStart + readLen;
+		int lowBound = 0;
+		int highBound = genes.size();
+		while(lowBound != highBound){
+			int midpoint = (lowBound + highBound) / 2;
+			if((unsigned long long)genes[midpoint].start + maxGene <= rStart){
+				lowBound = midpoint + 1;
+			}else{
+				highBound = midpoint;
+			}
+		}
+		for(int i=lowBound; i < genes.size() && genes[i].start < rEnd; i++){
+			scanVisited++;
+			if(rStart < genes[i].end){
+				scanHits++;
+			}
+		}
+	}
+	double scanSecs = (clock() - t0) / (double)CLOCKS_PER_SEC;
+	
+	// IntervalIndex
+	t0 = clock();
+	IntervalIndex geneIndex;
+	for(int i=0; i < genes.size(); i++){
+		geneIndex.add(genes[i].start, genes[i].end, i);
+	}
+	geneIndex.index();
+	double buildSecs = (clock() - t0) / (double)CLOCKS_PER_SEC;
+	
+	t0 = clock();
+	HitCounter counter;
+	for(int r=0; r < numReads; r++){
+		geneIndex.visitOverlaps(readStarts[r], readStarts[r] + readLen, counter);
+	}
+	const unsigned long long indexHits = counter.hits;
+	double indexSecs = (clock() - t0) / (double)CLOCKS_PER_SEC;
+	
+	// IntervalIndex, gathering hits into a list per read
+	t0 = clock();
+	unsigned long long listHits = 0;
+	vector<int> hits;
+	for(int r=0; r < numReads; r++){
+		hits.clear();
+		listHits += geneIndex.overlap(readStarts[r], readStarts[r] + readLen, hits);
+	}
+	double listSecs = (clock() - t0) / (double)CLOCKS_PER_SEC;
+	
+	cout << "Features: " << numGenes << " (" << numLongGenes << " megabase-long, longest " << maxGene << " bp)\n";
+	cout << "Reads: " << numReads << (sortedReads ? " (coordinate sorted)" : " (random order)") << "\n";
+	cout << "Sorted-start scan:\t" << scanSecs << " s\t" << (numReads / scanSecs) << " reads/s\t";
+	cout << (scanVisited / (double)numReads) << " features visited per read\t" << scanHits << " overlaps\n";
+	cout << "IntervalIndex:\t\t" << indexSecs << " s\t" << (numReads / indexSecs) << " reads/s\t";
+	cout << "(build " << buildSecs << " s)\t" << indexHits << " overlaps\n";
+	cout << "IntervalIndex, list:\t" << listSecs << " s\t" << (numReads / listSecs) << " reads/s\t";
+	cout << listHits << " overlaps\n";
+	if(scanHits != indexHits || scanHits != listHits){
+		cerr << "Overlap counts differ!\n";
+		return 1;
+	}
+	return 0;
+}
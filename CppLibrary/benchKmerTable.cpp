@@ -0,0 +1,113 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <stdint.h>
+#include <unistd.h>
+#include "KmerHashTable.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/** Benchmark of k-mer count loading, as done per input record by mergeKmerCounts.
+** Compares the former map< string, vector<unsigned int> > (count() then operator[]) against KmerHashTable,
+** reporting inserts/sec and resident memory per distinct k-mer.
+** Records are random k-mers drawn from a set half the number of records, spread over the samples, as text.
+** Build: g++ -O2 -o benchKmerTable benchKmerTable.cpp KmerHashTable.cpp
+**/
+
+const char progName[] = "benchKmerTable";
+
+/*** Resident memory of this process, in bytes
+**/
+size_t residentBytes(){
+	ifstream statm("/proc/self/statm");
+	size_t totalPages = 0;
+	size_t residentPages = 0;
+	statm >> totalPages >> residentPages;
+	return residentPages * sysconf(_SC_PAGESIZE);
+}
+
+/*** Record number i's k-mer as text, from a fixed pseudo-random sequence over numDistinct k-mers
+**/
+void makeKmer(uint64_t i, uint64_t numDistinct, int kmerLen, string& kmerSeq){
+	static const char bases[4] = {'A', 'C', 'G', 'T'};
+	uint64_t x = (i * 0x9e3779b97f4a7c15ULL) % numDistinct + 1;
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	for(int j=0; j < kmerLen; j++){
+		kmerSeq[j] = bases[(x >> (2 * (j % 32))) & 3];
+	}
+}
+
+int main(int argc,char *argv[]){
+
+	uint64_t numRecords = 100000000;
+	int numSamples = 4;
+	int kmerLen = 31;
+	bool runMap = true;
+	if(argc > 1){
+		numRecords = strtoull(argv[1], NULL, 10);
+	}
+	if(argc > 2){
+		numSamples = atoi(argv[2]);
+	}
+	if(argc > 3){
+		kmerLen = atoi(argv[3]);
+	}
+	if(argc > 4){
+		runMap = (string(argv[4]) != "nomap");
+	}
+	if(argc > 5 || numRecords < 2 || numSamples < 1 || kmerLen < 1 || kmerLen > 32){
+		cerr << "\t***** " << progName << " *****\n";
+		cerr << "Command line usage:\n" << argv[0] << " [num k-mer records (100000000)] [num samples (4)] [k-mer length (31)] [map/nomap]\n";
+		return 1;
+	}
+	const uint64_t numDistinct = numRecords / 2;
+	string kmerSeq(kmerLen, 'A');
+	cout << "Loading " << numRecords << " records of " << numDistinct << " possible " << kmerLen << "-mers over " << numSamples << " samples" << endl;
+
+	// KmerHashTable
+	{
+		size_t memBefore = residentBytes();
+		clock_t startTime = clock();
+		KmerHashTable kmerTable;
+		kmerTable.init(numSamples);
+		for(uint64_t i=0; i < numRecords; i++){
+			makeKmer(i, numDistinct, kmerLen, kmerSeq);
+			uint64_t key;
+			KmerHashTable::encode(kmerSeq, key);
+			kmerTable.insert(key)[i % numSamples] = (unsigned int)i;
+		}
+		double secs = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+		size_t memUsed = residentBytes() - memBefore;
+		cout << "KmerHashTable:\t" << kmerTable.size() << " k-mers, " << secs << " s, ";
+		cout << (uint64_t)(numRecords / secs) << " inserts/s, " << (double)memUsed / kmerTable.size() << " bytes/k-mer resident";
+		cout << " (" << (double)kmerTable.memBytes() / kmerTable.size() << " bytes/k-mer in table)" << endl;
+	}
+
+	// Former map
+	if(runMap){
+		size_t memBefore = residentBytes();
+		clock_t startTime = clock();
+		map< string, vector< unsigned int > > kmerCounts;
+		for(uint64_t i=0; i < numRecords; i++){
+			makeKmer(i, numDistinct, kmerLen, kmerSeq);
+			if(kmerCounts.count(kmerSeq) == 0){
+				kmerCounts[kmerSeq] = vector< unsigned int >(numSamples, 0);
+			}
+			kmerCounts[kmerSeq][i % numSamples] = (unsigned int)i;
+		}
+		double secs = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+		size_t memUsed = residentBytes() - memBefore;
+		cout << "map:\t\t" << kmerCounts.size() << " k-mers, " << secs << " s, ";
+		cout << (uint64_t)(numRecords / secs) << " inserts/s, " << (double)memUsed / kmerCounts.size() << " bytes/k-mer resident" << endl;
+	}
+	return 0;
+}
@@ -3,6 +3,7 @@
 #include <string>
 #include <cstdlib>
 #include "SeqReader.h"
+#include "SeqComplexity.h"
 using namespace std;
 
 /* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
@@ -13,7 +14,7 @@ const char progName[] = "extractSeqSubsets";
 
 void printHelp();
 bool getInputs(int argc, char* argv[], string& inFileName, string& outFileName, 
-			int& skipNum, unsigned long& maxNum, int& maxGbp, int& mode, int& X);
+			int& skipNum, unsigned long& maxNum, int& maxGbp, int& mode, int& X, bool& filterPoly, double& maxDust);
 
 int main(int argc,char *argv[]){
 
@@ -25,8 +26,10 @@ int main(int argc,char *argv[]){
 	unsigned long maxbp = 0;
 	int mode = 0; // 0 = print-all, 1 = extract-every-X mode, 2 = exclude-every-X mode
 	int X = 0;
+	bool filterPoly = false;
+	double maxDust = -1;
 	
-	if(!getInputs(argc, argv, inFileName, outFileName, skipNum, maxNum, maxGbp, mode, X)){
+	if(!getInputs(argc, argv, inFileName, outFileName, skipNum, maxNum, maxGbp, mode, X, filterPoly, maxDust)){
 		cerr << "Process aborted.\n";
 		return 0;
 	}
@@ -39,15 +42,21 @@ int main(int argc,char *argv[]){
 	}
 	
 	SeqReader inFile(inFileName);
+	SeqComplexity complexity;
 	
 	int counter = 0;
 	int skipCount = 0;
 	unsigned long printbp = 0;
 	unsigned long numPrinted = 0;
+	unsigned long numLowComplexity = 0;
 
 	while( inFile.nextSeq() && (numPrinted < maxNum || maxNum == 0) && (printbp < maxbp || maxbp == 0) ){
 
-		if(skipNum > 0 && skipCount < skipNum){
+		// Low complexity sequences are dropped before skipping and subsetting
+		if( (filterPoly || maxDust >= 0) && complexity.isLowComplexity(inFile.getSeq(), filterPoly, maxDust) ){
+			numLowComplexity++;
+
+		}else if(skipNum > 0 && skipCount < skipNum){
 			skipCount++;
 
 		}else if(mode == 0){  // Print all
@@ -77,11 +86,14 @@ int main(int argc,char *argv[]){
 	}
 	
 	cout << "Output " << numPrinted << " sequences (" << printbp << " bp).\n";
+	if(filterPoly || maxDust >= 0){
+		cout << "Dropped " << numLowComplexity << " low complexity sequences.\n";
+	}
 	return 0;
 }
 
 bool getInputs(int argc, char* argv[], string& inFileName, string& outFileName, 
-			int& skipNum, unsigned long& maxNum, int& maxGbp, int& mode, int& X){
+			int& skipNum, unsigned long& maxNum, int& maxGbp, int& mode, int& X, bool& filterPoly, double& maxDust){
 	extern char *optarg;
 	int opt;
 	mode = 0; // 0 = print-all, 1 = extract-every-X mode, 2 = exclude-every-X mode
@@ -89,7 +101,9 @@ bool getInputs(int argc, char* argv[], string& inFileName, string& outFileName,
 	skipNum = 0;
 	maxNum = 0;
 	maxGbp = 0;
-	while ((opt = getopt(argc,argv,"i:o:s:n:m:ecx:h")) != EOF){
+	filterPoly = false;
+	maxDust = -1;
+	while ((opt = getopt(argc,argv,"i:o:s:n:m:ecx:pd:h")) != EOF){
 		switch(opt){
 			case 'i':
 				inFileName = optarg;
@@ -115,6 +129,12 @@ bool getInputs(int argc, char* argv[], string& inFileName, string& outFileName,
 			case 'x':
 				X = atoi(optarg);
 				break;
+			case 'p':
+				filterPoly = true;
+				break;
+			case 'd':
+				maxDust = atof(optarg);
+				break;
 			case 'h':
 			case '?':
 			default:
@@ -142,6 +162,8 @@ void printHelp(){
 	cerr << "\t-e\t\tExtract every Xth seq (-x below). For retaining <50% of input.\n";
 	cerr << "\t-c\t\tExclude every Xth seq (-x below). For retaining >50% of input.\n";
 	cerr << "\t-x X\t\tNumber- For the extract and eclude modes.\n";
+	cerr << "\t-p\t\tDrop poly-N sequences (one base over 2/3 of length, or a 2-base repeat over 1/3).\n";
+	cerr << "\t-d maxDust\tNumber- Drop sequences with DUST score above this (~0.5 for random sequence, 24 for a 50bp homopolymer).\n";
 	cerr << "Extract-every-X and exclude-every-X modes and mutually exclusive.\n\n";
 }
 
@@ -3,6 +3,7 @@
 #include <string>
 #include <cstdlib>
 #include "SeqReader.h"
+#include "SeqComplexity.h"
 using namespace std;
 
 /* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
@@ -11,7 +12,7 @@ using namespace std;
 
 const char progName[] = "filterSeqSize";
 
-bool getInputs(int argc, char* argv[], string& inFileName, string& outFileName, int& minSize, int& maxSize);
+bool getInputs(int argc, char* argv[], string& inFileName, string& outFileName, int& minSize, int& maxSize, bool& filterPoly, double& maxDust);
 
 int main(int argc,char *argv[]){
 
@@ -19,10 +20,13 @@ int main(int argc,char *argv[]){
 	string outFileName;
 	int minSize = -1;
 	int maxSize = -1;
+	bool filterPoly = false;
+	double maxDust = -1;
 	int countKept = 0;
 	int countReject = 0;
+	int countLowComplexity = 0;
 	
-	if(!getInputs(argc, argv, inFileName, outFileName, minSize, maxSize)){
+	if(!getInputs(argc, argv, inFileName, outFileName, minSize, maxSize, filterPoly, maxDust)){
 		cerr << "Process aborted.\n";
 		return 0;
 	}
@@ -34,13 +38,19 @@ int main(int argc,char *argv[]){
 	}
 	
 	SeqReader inFile(inFileName);
+	SeqComplexity complexity;
 	
 	while(inFile.nextSeq()){
 		int len = inFile.getSeqLen();
 		
 		if((minSize == -1 || len >= minSize) && (maxSize == -1 || len <= maxSize)){
-			outfile << inFile.toString();
-			countKept++;
+			if( (filterPoly || maxDust >= 0) && complexity.isLowComplexity(inFile.getSeq(), filterPoly, maxDust) ){
+				countLowComplexity++;
+				countReject++;
+			}else{
+				outfile << inFile.toString();
+				countKept++;
+			}
 		}else{
 			countReject++;
 		}
@@ -48,16 +58,21 @@ int main(int argc,char *argv[]){
 	
 	cout << "Filtered " << inFileName << " for min:" << minSize << " to max:" << maxSize << "\n";
 	cout << "Retained = " << countKept << " | Rejected = " << countReject << "\n";
+	if(filterPoly || maxDust >= 0){
+		cout << "(Rejected as low complexity = " << countLowComplexity << ")\n";
+	}
 	return 0;
 }
 
-bool getInputs(int argc, char* argv[], string& inFileName, string& outFileName, int& minSize, int& maxSize){
-	if(argc != 5){
+bool getInputs(int argc, char* argv[], string& inFileName, string& outFileName, int& minSize, int& maxSize, bool& filterPoly, double& maxDust){
+	if(argc < 5 || argc > 7){
 		cerr << "\t***** " << progName << " *****\n\t- Andrew Spriggs, CSIRO Ag&Food, 2018 -\n";
 		cerr << "Extract subset of sequences within a length range.\n";
 		cerr << "Input file may be fasta or fastq and may be .gz compressed.\n";
-		cerr << "Correct command line usage:\n" << argv[0] << " <infile> <outfile> <min seq len> <max seq len>\n";
+		cerr << "Correct command line usage:\n" << argv[0] << " <infile> <outfile> <min seq len> <max seq len> [filter poly-N T/F] [max DUST score]\n";
 		cerr << "Give a min or max of -1 for no limit\nMax and min are inclusive\n";
+		cerr << "Optionally also reject low complexity sequences: poly-N (one base over 2/3 of length, or a 2-base repeat over 1/3),\n";
+		cerr << "and/or DUST score above a maximum (triplet repeat score: ~0.5 for random sequence, 24 for a 50bp homopolymer).\n";
 		return false;
 	}
 	
@@ -65,6 +80,20 @@ bool getInputs(int argc, char* argv[], string& inFileName, string& outFileName,
 	outFileName = argv[2];
 	minSize = atoi(argv[3]);
 	maxSize = atoi(argv[4]);
+	filterPoly = false;
+	maxDust = -1;
+	if(argc > 5){
+		string filterAns = argv[5];
+		if(filterAns[0] == 'T' || filterAns[0] == 't'){
+			filterPoly = true;
+		}else if(filterAns[0] != 'F' && filterAns[0] != 'f'){
+			cerr << "Filter poly-N should be T or F!\n";
+			return false;
+		}
+	}
+	if(argc > 6){
+		maxDust = atof(argv[6]);
+	}
 	
 	return true;
 }
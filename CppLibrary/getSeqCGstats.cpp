@@ -1,8 +1,9 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <iomanip>
-#include "SeqReader.h"
+#include <vector>
+#include "SeqStats.h"
+#include "SeqStatsReport.h"
 using namespace std;
 
 /* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
@@ -28,49 +29,12 @@ int main(int argc,char *argv[]){
 		cerr << "Unable to open output file " << outFileName << "!\nProcess aborted.\n";
 		return 0;
 	}
-	outfile << "ID\tLength\tCG%\tA\tT\tC\tG\n";
 	
-	SeqReader inFile(inFileName);
-	
-	while(inFile.nextSeq()){
-		
-		outfile << inFile.getSeqID() << "\t" << inFile.getSeqLen() << "\t";
-		
-		string seq = inFile.getSeq();
-		
-		int aCount = 0;
-		int tCount = 0;
-		int cCount = 0;
-		int gCount = 0;
-		
-		for(int i=0; i<seq.length(); i++){
-			switch (seq[i]){
-				case 'A':
-				case 'a':
-					aCount++;
-					break;
-				case 'T':
-				case 't':
-					tCount++;
-					break;
-				case 'C':
-				case 'c':
-					cCount++;
-					break;
-				case 'G':
-				case 'g':
-					gCount++;
-			}
-		}
-		
-		double cgPC = (cCount+gCount) / (double)seq.length() * 100.00;
-		outfile.setf(ios::fixed);
-		outfile << setprecision(2) << cgPC << "\t";
-		outfile << aCount << "\t";
-		outfile << tCount << "\t";
-		outfile << cCount << "\t";
-		outfile << gCount << "\n";
-	}
+	CGStatsReport report(outfile);
+	vector<SeqStatsReport*> reports(1, &report);
+	vector<string> inFileNames(1, inFileName);
+	vector<SeqStats> fileStats;
+	SeqStats::runReports(inFileNames, reports, 1, fileStats);
 
 	return 0;
 }
@@ -1,11 +1,16 @@
+#include <omp.h>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
-#include <map>
-#include <set>
 #include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
 #include "SeqReader.h"
+#include "SeqCountTable.h"
+#include "SeqRunSet.h"
+#include "SeqComplexity.h"
+#include <stdint.h>
 using namespace std;
 
 /* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
@@ -14,8 +19,25 @@ using namespace std;
 
 const char progName[] = "getSeqCountTable";
 
-bool getInputs(int argc, char* argv[], vector<string>& inFileNames, string& outFileName, bool& filterPoly, bool& singletons);
-bool isPolySeq(const string& seq);
+bool getInputs(int argc, char* argv[], vector<string>& inFileNames, string& outFileName, bool& filterPoly, bool& singletons, string& tempDir, int& maxMemMB);
+void printHelp(char* progCall);
+void countFilesInShards(const vector<string>& inFileNames, vector<SeqCountTable>& shards);
+bool countFilesToRuns(const vector<string>& inFileNames, const int maxMemMB, SeqRunSet& runSet);
+void writeSeqRow(ofstream& outfile, const unsigned long seqNum, const string& seq, const unsigned int* seqCounts, const int numSamples, const bool filterPoly, const bool singletons, SeqComplexity& complexity);
+
+const int shardBits = 6; //!< Parallel counting, distinct sequences split over 2^shardBits shards by hash for merging
+
+struct ShardSeqPos {
+	int shardNum;
+	size_t pos; //!< Position in shard's sorted entries
+}; //!< Next sequence of a shard, during the ordered merge of shards for output
+
+struct ShardSeqAfter {
+	const vector<string>* shardSeqs;
+	bool operator () (const ShardSeqPos& a, const ShardSeqPos& b) const{
+		return ((*shardSeqs)[a.shardNum] > (*shardSeqs)[b.shardNum]);
+	}
+}; //!< Heap ordering of shards, by their next sequences
 
 int main(int argc,char *argv[]){
 
@@ -23,34 +45,37 @@ int main(int argc,char *argv[]){
 	string outFileName;
 	bool filterPoly;
 	bool singletons;
+	string tempDir = "";
+	int maxMemMB = 1024;
 	
-	if(!getInputs(argc, argv, inFileNames, outFileName, filterPoly, singletons)){
+	if(!getInputs(argc, argv, inFileNames, outFileName, filterPoly, singletons, tempDir, maxMemMB)){
 		cerr << "Process aborted.\n";
 		return 0;
 	}
 	
 	const int numSamples = inFileNames.size();
-	map<string, vector<unsigned long> > counts;
+	vector<SeqCountTable> shards;
+	SeqRunSet runSet;
 	
-	for(int fileNum = 0; fileNum < numSamples; fileNum++){
-		
-		SeqReader inFile(inFileNames[fileNum]);
-				
-		cout << "Processing " << inFileNames[fileNum] << "\n";
-		
-		while(inFile.nextSeq()){
-			string seq = inFile.getSeq();
+	if(tempDir != ""){
+		runSet.init(tempDir, numSamples);
+		if(!countFilesToRuns(inFileNames, maxMemMB, runSet)){
+			cerr << "Process aborted.\n";
+			return 0;
+		}
+	}else if(numSamples > 1 && omp_get_max_threads() > 1){
+		countFilesInShards(inFileNames, shards);
+	}else{
+		shards.resize(1);
+		shards[0].init(numSamples);
+		for(int fileNum = 0; fileNum < numSamples; fileNum++){
 			
-			map<string, vector<unsigned long> >::iterator seqRec = counts.find(seq);
+			SeqReader inFile(inFileNames[fileNum]);
+					
+			cout << "Processing " << inFileNames[fileNum] << "\n";
 			
-			if(seqRec != counts.end()){
-				(*seqRec).second[fileNum] = (*seqRec).second[fileNum] + 1;
-				(*seqRec).second[numSamples] = (*seqRec).second[numSamples] + 1;
-			}else{
-				vector<unsigned long> countVec(numSamples+1, 0);
-				countVec[fileNum] = 1;
-				countVec[numSamples] = 1;
-				counts[seq] = countVec;
+			while(inFile.nextSeq()){
+				shards[0].insert(inFile.getSeq())[fileNum]++;
 			}
 		}
 	}
@@ -73,17 +98,61 @@ int main(int argc,char *argv[]){
 	}
 	outfile << "\n";
 	
-	for (map<string, vector<unsigned long> >::iterator seqRec = counts.begin(); seqRec!=counts.end(); ++seqRec){
-		
-		if( singletons || (*seqRec).second[numSamples] > 1 ){
-			if( !filterPoly || !isPolySeq((*seqRec).first) ){
-				outfile << seqNum << "\t" << (*seqRec).first;
-				for(int fileNum = 0; fileNum < numSamples; fileNum++){
-					outfile << "\t" << (*seqRec).second[fileNum];
-				}
-				outfile << "\n";
-			}
+	// IDs number all distinct sequences in alphabetical order, including any not printed
+	SeqComplexity complexity;
+	if(tempDir != ""){
+		// Runs merged in alphabetical order, each sequence's counts summed over its sample's runs
+		if(!runSet.startMerge()){
+			cerr << "Process aborted.\n";
+			return 0;
 		}
+		string seq;
+		vector<unsigned int> seqCounts;
+		while(runSet.nextRow(seq, seqCounts)){
+			writeSeqRow(outfile, seqNum, seq, &seqCounts[0], numSamples, filterPoly, singletons, complexity);
+			seqNum++;
+		}
+		runSet.removeRuns();
+		outfile.close();
+		return 0;
+	}
+	
+	// Each shard sorted, then shards merged in order with a heap on their next sequences
+	const int numShards = shards.size();
+	vector< vector<uint32_t> > sortedSeqs(numShards);
+	#pragma omp parallel for schedule(dynamic)
+	for(int shardNum = 0; shardNum < numShards; shardNum++){
+		shards[shardNum].sortedEntries(sortedSeqs[shardNum]);
+	}
+	vector<string> shardSeqs(numShards);
+	vector<ShardSeqPos> heap;
+	for(int shardNum = 0; shardNum < numShards; shardNum++){
+		if(!sortedSeqs[shardNum].empty()){
+			const uint32_t entryNum = sortedSeqs[shardNum][0];
+			shardSeqs[shardNum].assign(shards[shardNum].getSeq(entryNum), shards[shardNum].getSeqLen(entryNum));
+			ShardSeqPos next = {shardNum, 0};
+			heap.push_back(next);
+		}
+	}
+	ShardSeqAfter after = {&shardSeqs};
+	make_heap(heap.begin(), heap.end(), after);
+
+	while(!heap.empty()){
+		pop_heap(heap.begin(), heap.end(), after);
+		ShardSeqPos& next = heap.back();
+		const SeqCountTable& shard = shards[next.shardNum];
+		const string seq = shardSeqs[next.shardNum];
+		const unsigned int* seqCounts = shard.getCounts(sortedSeqs[next.shardNum][next.pos]);
+		next.pos++;
+		if(next.pos < sortedSeqs[next.shardNum].size()){
+			const uint32_t entryNum = sortedSeqs[next.shardNum][next.pos];
+			shardSeqs[next.shardNum].assign(shard.getSeq(entryNum), shard.getSeqLen(entryNum));
+			push_heap(heap.begin(), heap.end(), after);
+		}else{
+			heap.pop_back();
+		}
+
+		writeSeqRow(outfile, seqNum, seq, seqCounts, numSamples, filterPoly, singletons, complexity);
 		seqNum++;
 	}
 	
@@ -92,81 +161,155 @@ int main(int argc,char *argv[]){
 	return 0;
 }
 
-bool isPolySeq(const string& seq){
-	
-	const float maxSingle = seq.length() * 2.0 / 3.0;
-	const float maxDuos = seq.length() * 2.0 / 6.0;
-	set<string> tested;
-	
-	for(int i=0; i<seq.length(); i++){
-		string base = (seq.substr(i, 1));
-		if(tested.find(base) == tested.end()){
-			tested.insert(base);
-			int count = 1;
-			for(int j=i+1; j<seq.length(); j++){
-				if(seq[j] == seq[i]){
-					count++;
-				}
-			}
-			if(count >= maxSingle){
-				return true;
+/*** Count each input file into its own table in parallel, then merge the tables into shards by hash, in parallel over shards
+**/
+void countFilesInShards(const vector<string>& inFileNames, vector<SeqCountTable>& shards){
+	const int numSamples = inFileNames.size();
+	const int numShards = 1 << shardBits;
+	vector<SeqCountTable> fileCounts(numSamples);
+	vector< vector< vector<uint32_t> > > fileShardEntries(numSamples, vector< vector<uint32_t> >(numShards));
+
+	#pragma omp parallel for schedule(dynamic)
+	for(int fileNum = 0; fileNum < numSamples; fileNum++){
+		SeqReader inFile(inFileNames[fileNum]);
+		#pragma omp critical
+		cout << "Processing " << inFileNames[fileNum] << "\n";
+		fileCounts[fileNum].init(1);
+		while(inFile.nextSeq()){
+			fileCounts[fileNum].insert(inFile.getSeq())[0]++;
+		}
+		// Note each shard's sequences, by top bits of hash (tables use the low bits)
+		for(uint32_t entryNum = 0; entryNum < fileCounts[fileNum].size(); entryNum++){
+			fileShardEntries[fileNum][fileCounts[fileNum].getHash(entryNum) >> (32 - shardBits)].push_back(entryNum);
+		}
+	}
+
+	cout << "Merging counts...\n";
+	shards.resize(numShards);
+	#pragma omp parallel for schedule(dynamic)
+	for(int shardNum = 0; shardNum < numShards; shardNum++){
+		shards[shardNum].init(numSamples);
+		for(int fileNum = 0; fileNum < numSamples; fileNum++){
+			const SeqCountTable& fileCount = fileCounts[fileNum];
+			const vector<uint32_t>& entryNums = fileShardEntries[fileNum][shardNum];
+			for(size_t i = 0; i < entryNums.size(); i++){
+				const uint32_t entryNum = entryNums[i];
+				shards[shardNum].insert(fileCount.getSeq(entryNum), fileCount.getSeqLen(entryNum), fileCount.getHash(entryNum))[fileNum] = fileCount.getCounts(entryNum)[0];
 			}
 		}
-		if(i>0){
-			string duo = (seq.substr(i-1, 2));
-			if(tested.find(duo) == tested.end()){
-				tested.insert(duo);
-				int count = 1;
-				for(int j=i+2; j<seq.length(); j=j+2){
-					if(seq[j-1] == seq[i-1] && seq[j] == seq[i]){
-						count++;
-					}
-				}
-				if(count >= maxDuos){
-					return true;
+	}
+}
+
+/*** Count each input file in parallel into its own table, writing the table to disk as a sorted run whenever it outgrows its share of maxMemMB
+**/
+bool countFilesToRuns(const vector<string>& inFileNames, const int maxMemMB, SeqRunSet& runSet){
+	const int numSamples = inFileNames.size();
+	const size_t maxTableBytes = (size_t)maxMemMB * 1048576 / omp_get_max_threads();
+	bool allOK = true;
+
+	#pragma omp parallel for schedule(dynamic)
+	for(int fileNum = 0; fileNum < numSamples; fileNum++){
+		SeqReader inFile(inFileNames[fileNum]);
+		#pragma omp critical
+		cout << "Processing " << inFileNames[fileNum] << "\n";
+		SeqCountTable fileCount;
+		unsigned long numReads = 0;
+		while(inFile.nextSeq()){
+			fileCount.insert(inFile.getSeq())[0]++;
+			numReads++;
+			if(numReads % 4096 == 0 && fileCount.memBytes() > maxTableBytes){
+				if(!runSet.writeRun(fileNum, fileCount)){
+					allOK = false;
 				}
+				fileCount.init(1);
 			}
 		}
+		if(!runSet.writeRun(fileNum, fileCount)){
+			allOK = false;
+		}
+	}
+	cout << "Merging " << runSet.numRuns() << " runs...\n";
+	return allOK;
+}
+
+/*** Write a sequence's row of counts, unless a singleton being removed or a poly-N being filtered
+**/
+void writeSeqRow(ofstream& outfile, const unsigned long seqNum, const string& seq, const unsigned int* seqCounts, const int numSamples, const bool filterPoly, const bool singletons, SeqComplexity& complexity){
+	unsigned long totCount = 0;
+	for(int fileNum = 0; fileNum < numSamples; fileNum++){
+		totCount += seqCounts[fileNum];
 	}
 	
-	return false;
+	if( singletons || totCount > 1 ){
+		if( !filterPoly || !complexity.isPolySeq(seq) ){
+			outfile << seqNum << "\t" << seq;
+			for(int fileNum = 0; fileNum < numSamples; fileNum++){
+				outfile << "\t" << seqCounts[fileNum];
+			}
+			outfile << "\n";
+		}
+	}
 }
 
-bool getInputs(int argc, char* argv[], vector<string>& inFileNames, string& outFileName, bool& filterPoly, bool& singletons){
-	if(argc < 5){
-		cerr << "\t***** " << progName << " *****\n\t- Andrew Spriggs, CSIRO Ag&Food, 2018 -\n";
-		cerr << "Produces a table of occurances of individual sequences per input.\n";
-		cerr << "Input files may be fasta or fastq and may be .gz compressed.\n";
-		cerr << "Command line usage:\n" << argv[0] << " <out tab file> <filter poly-N T/F> <remove singletons T/F> <in seq file> [more in files]\n";
+bool getInputs(int argc, char* argv[], vector<string>& inFileNames, string& outFileName, bool& filterPoly, bool& singletons, string& tempDir, int& maxMemMB){
+	int opt;
+	extern char *optarg;
+	extern int optind;
+	// Options come before the positional arguments
+	while ((opt = getopt(argc,argv,"+T:M:h")) != EOF){
+		switch(opt){
+			case 'T':
+				tempDir = optarg;
+				break;
+			case 'M':
+				maxMemMB = atoi( optarg );
+				break;
+			case 'h':
+			case '?':
+			default:
+				printHelp(argv[0]);
+				return false;
+		}
+	}
+	if(argc - optind < 4 || maxMemMB < 1){
+		printHelp(argv[0]);
 		return false;
 	}
 	
-	outFileName = argv[1];
-	string filterAns = argv[2];
+	outFileName = argv[optind];
+	string filterAns = argv[optind + 1];
 	if(filterAns[0] == 'T' || filterAns[0] == 't'){
 		filterPoly = true;
 	}else if(filterAns[0] == 'F' || filterAns[0] == 'f'){
 		filterPoly = false;
 	}else{
-		cerr << "\t***** " << progName << " *****\n\t- Andrew Spriggs, CSIRO Ag&Food, 2018 -\n";
-		cerr << "Correct command line usage:\n" << argv[0] << " <out tab file> <filter poly-N T/F> <remove singletons T/F> <in seq file> [more in files]\n";
+		printHelp(argv[0]);
 		return false;
 	}
-	string singlesAns = argv[3];
+	string singlesAns = argv[optind + 2];
 	if(singlesAns[0] == 'T' || singlesAns[0] == 't'){
 		singletons = false;
 	}else if(singlesAns[0] == 'F' || singlesAns[0] == 'f'){
 		singletons = true;
 	}else{
-		cerr << "\t***** " << progName << " *****\n\t- Andrew Spriggs, CSIRO Ag&Food, 2018 -\n";
-		cerr << "Correct command line usage:\n" << argv[0] << " <out tab file> <filter poly-N T/F> <remove singletons T/F> <in seq file> [more in files]\n";
+		printHelp(argv[0]);
 		return false;
 	}
 	
-	for(int i = 4; i < argc; i++){
+	for(int i = optind + 3; i < argc; i++){
 		string aFileName(argv[i]);
 		inFileNames.push_back(aFileName);
 	}
 	return true;
 }
 
+void printHelp(char* progCall){
+	cerr << "\t***** " << progName << " *****\n\t- Andrew Spriggs, CSIRO Ag&Food, 2018 -\n";
+	cerr << "Produces a table of occurances of individual sequences per input.\n";
+	cerr << "Input files may be fasta or fastq and may be .gz compressed.\n";
+	cerr << "Input files are counted in parallel over OMP_NUM_THREADS threads.\n";
+	cerr << "Command line usage:\n" << progCall << " [options] <out tab file> <filter poly-N T/F> <remove singletons T/F> <in seq file> [more in files]\n";
+	cerr << "Options:\n";
+	cerr << "\t-T tempDir\t\tEnable external mode: count in bounded memory, writing sorted runs of counts to disk in tempDir, then merging them\n";
+	cerr << "\t-M maxMemMB\t\tExternal mode, memory for sequences held before writing a run, shared between OMP_NUM_THREADS threads (default=1024)\n";
+}
@@ -2,8 +2,8 @@
 #include <fstream>
 #include <string>
 #include <vector>
-#include <algorithm>
-#include "SeqReader.h"
+#include "SeqStats.h"
+#include "SeqStatsReport.h"
 using namespace std;
 
 /* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
@@ -23,41 +23,11 @@ int main(int argc,char *argv[]){
 		cerr << "Process aborted.\n";
 		return 0;
 	}
-	const int numSamples = inFileNames.size();
-	vector<vector<int> > seqSizes(numSamples, vector<int>(1, 0));
 	
-	for(int fileNum = 0; fileNum < numSamples; fileNum++){
-		
-		SeqReader inFile(inFileNames[fileNum]);
-				
-		cerr << "Processing " << inFileNames[fileNum] << "\n";
-		
-		while(inFile.nextSeq()){
-			int len = inFile.getSeqLen();
-			if(len >= seqSizes[0].size()){
-				for(int i = 0; i < numSamples; i++){
-					for(int j = seqSizes[i].size(); j <= len; j++){
-						seqSizes[i].push_back(0);
-					}
-				}
-			}
-			seqSizes[fileNum][len] = seqSizes[fileNum][len] + 1;
-		}
-	}
-	
-	cout << "Size";
-	for(int fileNum = 0; fileNum < numSamples; fileNum++){
-		cout << "\t" << inFileNames[fileNum];
-	}
-	cout << "\n";
-	for(int len = 0; len < seqSizes[0].size(); len++){
-		cout << len;
-		for(int fileNum = 0; fileNum < numSamples; fileNum++){
-			cout << "\t" << seqSizes[fileNum][len];
-		}
-		cout << "\n";
-	}
-	cout << "\n";
+	SizeChartReport report(cout);
+	vector<SeqStatsReport*> reports(1, &report);
+	vector<SeqStats> fileStats;
+	SeqStats::runReports(inFileNames, reports, 1, fileStats);
 
 	return 0;
 }
@@ -67,6 +37,7 @@ bool getInputs(int argc, char* argv[], vector<string>& inFileNames){
 		cerr << "\t***** " << progName << " *****\n\t- Andrew Spriggs, CSIRO Ag&Food, 2018 -\n";
 		cerr << "Produces a table of sequence sizes and their counts per input.\n";
 		cerr << "Input files may be fasta or fastq and may be .gz compressed.\n";
+		cerr << "Input files are read in parallel over OMP_NUM_THREADS threads.\n";
 		cerr << "Command line usage:\n" << argv[0] << " <in seq file> [more in files]\n";
 		return false;
 	}
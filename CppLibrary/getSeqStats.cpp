@@ -0,0 +1,141 @@
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "SeqStats.h"
+#include "SeqStatsReport.h"
+using namespace std;
+
+/* By Andrew Spriggs, CSIRO Ag&Food, 2018 */
+/* andrew.spriggs@csiro.au */
+/* https://github.com/spriggsy83 */
+
+/** Produces any of the reports of getSeqSizeStats, getSeqSizeStatsT, getSeqQCStats, getSeqSizeChart and getSeqCGstats,
+** plus base composition and per-position quality, from a single read of each input **/
+
+const char progName[] = "getSeqStats";
+
+const int numReportTypes = 7;
+const char reportOpts[numReportTypes + 1] = "stqcgbQ"; //!< Option letter per report type, in the order reports are made
+
+bool getInputs(int argc, char* argv[], vector<string>& reportFileNames, int& profileEvery, vector<string>& inFileNames);
+void printHelp(char* progCall);
+
+int main(int argc,char *argv[]){
+
+	vector<string> reportFileNames(numReportTypes, "");
+	int profileEvery = 1;
+	vector<string> inFileNames;
+	
+	if(!getInputs(argc, argv, reportFileNames, profileEvery, inFileNames)){
+		cerr << "Process aborted.\n";
+		return 0;
+	}
+	
+	vector<ofstream*> outfiles;
+	vector<SeqStatsReport*> reports;
+	for(int reportNum = 0; reportNum < numReportTypes; reportNum++){
+		if(reportFileNames[reportNum] == ""){
+			continue;
+		}
+		ofstream* outfile = new ofstream(reportFileNames[reportNum].c_str());
+		outfiles.push_back(outfile);
+		if(!outfile->is_open()){
+			cerr << "Unable to open output file " << reportFileNames[reportNum] << "!\nProcess aborted.\n";
+			return 0;
+		}
+		switch(reportOpts[reportNum]){
+			case 's':
+				reports.push_back(new SizeStatsReport(*outfile));
+				break;
+			case 't':
+				reports.push_back(new SizeStatsTableReport(*outfile));
+				break;
+			case 'q':
+				reports.push_back(new QCStatsReport(*outfile));
+				break;
+			case 'c':
+				reports.push_back(new SizeChartReport(*outfile));
+				break;
+			case 'g':
+				reports.push_back(new CGStatsReport(*outfile));
+				break;
+			case 'b':
+				reports.push_back(new BaseCompositionReport(*outfile));
+				break;
+			case 'Q':
+				reports.push_back(new PositionQualReport(*outfile));
+				break;
+		}
+	}
+	
+	vector<SeqStats> fileStats;
+	SeqStats::runReports(inFileNames, reports, profileEvery, fileStats);
+	
+	for(size_t i = 0; i < reports.size(); i++){
+		delete reports[i];
+		delete outfiles[i];
+	}
+
+	return 0;
+}
+
+bool getInputs(int argc, char* argv[], vector<string>& reportFileNames, int& profileEvery, vector<string>& inFileNames){
+	int opt;
+	extern char *optarg;
+	extern int optind;
+	bool anyReport = false;
+	while ((opt = getopt(argc,argv,"s:t:q:c:g:b:Q:p:h")) != EOF){
+		switch(opt){
+			case 's':
+			case 't':
+			case 'q':
+			case 'c':
+			case 'g':
+			case 'b':
+			case 'Q':
+				reportFileNames[string(reportOpts).find(opt)] = optarg;
+				anyReport = true;
+				break;
+			case 'p':
+				profileEvery = atoi( optarg );
+				break;
+			case 'h':
+			case '?':
+			default:
+				printHelp(argv[0]);
+				return false;
+		}
+	}
+	if(!anyReport || optind >= argc || profileEvery < 1){
+		printHelp(argv[0]);
+		return false;
+	}
+	
+	for(int i = optind; i < argc; i++){
+		string aFileName(argv[i]);
+		inFileNames.push_back(aFileName);
+	}
+	return true;
+}
+
+void printHelp(char* progCall){
+	cerr << "\t***** " << progName << " *****\n\t- Andrew Spriggs, CSIRO Ag&Food, 2018 -\n";
+	cerr << "Profiles sequences for any of the stats of getSeqSizeStats, getSeqSizeStatsT, getSeqQCStats, getSeqSizeChart and getSeqCGstats,\n";
+	cerr << "plus base composition and mean quality per read position, reading each input once.\n";
+	cerr << "Input files may be fasta or fastq and may be .gz compressed.\n";
+	cerr << "Input files are read in parallel over OMP_NUM_THREADS threads, unless -g is given.\n";
+	cerr << "Command line usage:\n" << progCall << " <report options> <in file> [more in files]\n";
+	cerr << "Report options (at least one):\n";
+	cerr << "\t-s outFile\t\tLength stats, as getSeqSizeStats\n";
+	cerr << "\t-t outFile\t\tLength stats, as getSeqSizeStatsT\n";
+	cerr << "\t-q outFile\t\tCount, length, quality and GC% stats, as getSeqQCStats\n";
+	cerr << "\t-c outFile\t\tCounts per length, as getSeqSizeChart\n";
+	cerr << "\t-g outFile\t\tGC% and base counts per sequence, as getSeqCGstats\n";
+	cerr << "\t-b outFile\t\tBase counts and GC% per input\n";
+	cerr << "\t-Q outFile\t\tMean quality per read position per input\n";
+	cerr << "Other options:\n";
+	cerr << "\t-p profileEvery\t\tFor -q, profile GC% and quality of every X'th sequence (default=1)\n";
+}
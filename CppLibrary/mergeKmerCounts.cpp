@@ -15,7 +15,7 @@ using namespace std;
 /* andrew.spriggs@csiro.au */
 /* https://github.com/spriggsy83 */
 
-bool getInputs(int argc, char* argv[], string& inSamplesFileName, string& outTabFilename, int& minCount, bool& twoPass);
+bool getInputs(int argc, char* argv[], string& inSamplesFileName, string& outTabFilename, int& minCount, bool& twoPass, string& tempDir, int& maxMemMB, int& numShards, bool& canonical);
 bool getSamples(const string& inSamplesFileName, vector<string>& labels, vector<string>& inFileNames);
 void printHelp();
 
@@ -27,8 +27,12 @@ int main(int argc,char *argv[]){
 	string outTabFilename = "";
 	int minCount = 20;
 	bool twoPass = false;
+	string tempDir = "";
+	int maxMemMB = 1024;
+	int numShards = 1;
+	bool canonical = false;
 	
-	if(!getInputs(argc, argv, inSamplesFileName, outTabFilename, minCount, twoPass)){
+	if(!getInputs(argc, argv, inSamplesFileName, outTabFilename, minCount, twoPass, tempDir, maxMemMB, numShards, canonical)){
 		//cerr << "Process aborted.\n";
 		return 1;
 	}
@@ -38,7 +42,7 @@ int main(int argc,char *argv[]){
 		return 1;
 	}
 	
-	KmerCountMerger theKmerCountMerger(labels, inFileNames, outTabFilename, minCount, twoPass);
+	KmerCountMerger theKmerCountMerger(labels, inFileNames, outTabFilename, minCount, twoPass, tempDir, maxMemMB, numShards, canonical);
 	
 	if(theKmerCountMerger.MergeKmerCounts()){
 		return 0;
@@ -85,11 +89,12 @@ bool getSamples(const string& inSamplesFileName, vector<string>& labels, vector<
 	return true;
 }
 
-bool getInputs(int argc, char* argv[], string& inSamplesFileName, string& outTabFilename, int& minCount, bool& twoPass){
+bool getInputs(int argc, char* argv[], string& inSamplesFileName, string& outTabFilename, int& minCount, bool& twoPass, string& tempDir, int& maxMemMB, int& numShards, bool& canonical){
 	twoPass = false;
+	canonical = false;
 	extern char *optarg;
 	int opt;
-	while ((opt = getopt(argc,argv,"i:o:m:2h")) != EOF){
+	while ((opt = getopt(argc,argv,"i:o:m:2cT:M:S:h")) != EOF){
 		switch(opt){
 			case 'i':
 				inSamplesFileName = optarg;
@@ -103,6 +108,18 @@ bool getInputs(int argc, char* argv[], string& inSamplesFileName, string& outTab
 			case '2':
 				twoPass = true;
 				break;
+			case 'c':
+				canonical = true;
+				break;
+			case 'T':
+				tempDir = optarg;
+				break;
+			case 'M':
+				maxMemMB = atoi( optarg );
+				break;
+			case 'S':
+				numShards = atoi( optarg );
+				break;
 			case 'h':
 			case '?':
 			default:
@@ -124,13 +141,22 @@ void printHelp(){
 	cerr << "\t-i samplesFile\t\tFilename of samples list\n";
 	cerr << "\t-o outTabFile\t\tFilename for kmer counts table output\n";
 	cerr << "\t-m minCount\t\tMinimum count of a kmer from any sample required for kmer to be printed (default=20)\n";
-	cerr << "\t-2\t\tEnable two-pass mode, which may be faster with higher minCounts\n";
+	cerr << "\t-2\t\tEnable two-pass mode, which may use less memory with higher minCounts: inputs are read once,\n";
+	cerr << "\t\t\t\twith counts below minCount kept in temp files alongside outTabFile for the second pass\n";
+	cerr << "\t-c\t\tCanonical mode: merge each kmer with its reverse complement, adding a sample's counts of both and\n";
+	cerr << "\t\t\t\treporting the alphabetically first orientation\n";
+	cerr << "\t-T tempDir\t\tEnable external mode: sort each sample's kmers into runs on disk in tempDir, then merge them,\n";
+	cerr << "\t\t\t\tso memory use does not grow with the number of kmers (-2 is not needed)\n";
+	cerr << "\t-M maxMemMB\t\tExternal mode, memory for kmers held before writing a run, shared between OMP_NUM_THREADS threads (default=1024)\n";
+	cerr << "\t-S numShards\t\tSharded mode: split kmers by leading bases into numShards (rounded up to a power of 4), reading samples\n";
+	cerr << "\t\t\t\tand writing shards in parallel over OMP_NUM_THREADS threads (default=1, off)\n";
 	cerr << "\n\n";
 	cerr << "samplesFile should be a tab-separated file with each line representing a sample in the form:\n";
 	cerr << "sample-name\tkmer-count-file\n\n";
 	cerr << "...where kmer-count-file is the filename for either\n";
 	cerr << "1. a tab-separated result of kmer counting (kmer[tab]count)\n";
 	cerr << "OR 2. a FASTA-formatted result of kmer counting (seq ID as count),\n";
+	cerr << "OR 3. a Jellyfish database (.jf, binary/sorted format as written by jellyfish count, kmers up to 32 bases),\n";
 	cerr << "and sample-name is a short label to give the sample in outputs.\n";
-	cerr << "Kmer count files may be .gz compressed.\n\n";
+	cerr << "Kmer count files (other than Jellyfish) may be .gz compressed.\n\n";
 }
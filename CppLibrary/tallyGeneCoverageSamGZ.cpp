@@ -17,7 +17,7 @@ using namespace std;
 
 const char progName[] = "tallyGeneCoverageSamGZ";
 
-bool getInputs(int argc, char* argv[], string& inSamplesFileName, string& inCoordsFileName, string& outTabFilename, int& minReads, int& updown);
+bool getInputs(int argc, char* argv[], string& inSamplesFileName, string& inCoordsFileName, string& outTabFilename, int& minReads, int& updown, int& threadsPerSample, bool& depthMode, int& breadthDepth, string& coordsFormat, bool& strictOverlap, string& strandMode, int& excludeFlags, bool& fractionalNH, bool& taggedLines);
 bool getSamples(const string& inSamplesFileName, vector<string>& labels, vector<string>& inSAMFileNames);
 void printHelp();
 
@@ -30,8 +30,17 @@ int main(int argc,char *argv[]){
 	string outTabFilename = "";
 	int minReads = 20;
 	int updown = 0;
+	int threadsPerSample = 1;
+	bool depthMode = false;
+	int breadthDepth = 1;
+	string coordsFormat = "";
+	bool strictOverlap = false;
+	string strandMode = "no";
+	int excludeFlags = 0;
+	bool fractionalNH = false;
+	bool taggedLines = false;
 	
-	if(!getInputs(argc, argv, inSamplesFileName, inCoordFileName, outTabFilename, minReads, updown)){
+	if(!getInputs(argc, argv, inSamplesFileName, inCoordFileName, outTabFilename, minReads, updown, threadsPerSample, depthMode, breadthDepth, coordsFormat, strictOverlap, strandMode, excludeFlags, fractionalNH, taggedLines)){
 		//cerr << "Process aborted.\n";
 		return 1;
 	}
@@ -41,7 +50,7 @@ int main(int argc,char *argv[]){
 		return 1;
 	}
 	
-	GeneCoverageTallyer theCoverageTallyer(labels, inSAMFileNames, inCoordFileName, outTabFilename, minReads, updown);
+	GeneCoverageTallyer theCoverageTallyer(labels, inSAMFileNames, inCoordFileName, outTabFilename, minReads, updown, threadsPerSample, depthMode, breadthDepth, coordsFormat, strictOverlap, strandMode, excludeFlags, fractionalNH, taggedLines);
 	
 	if(theCoverageTallyer.tallyCoverage()){
 		return 0;
@@ -88,10 +97,10 @@ bool getSamples(const string& inSamplesFileName, vector<string>& labels, vector<
 	return true;
 }
 
-bool getInputs(int argc, char* argv[], string& inSamplesFileName, string& inCoordsFileName, string& outTabFilename, int& minReads, int& updown){
+bool getInputs(int argc, char* argv[], string& inSamplesFileName, string& inCoordsFileName, string& outTabFilename, int& minReads, int& updown, int& threadsPerSample, bool& depthMode, int& breadthDepth, string& coordsFormat, bool& strictOverlap, string& strandMode, int& excludeFlags, bool& fractionalNH, bool& taggedLines){
 	extern char *optarg;
 	int opt;
-	while ((opt = getopt(argc,argv,"i:c:o:m:u:h")) != EOF){
+	while ((opt = getopt(argc,argv,"i:c:o:m:u:t:db:f:e:s:F:nah")) != EOF){
 		switch(opt){
 			case 'i':
 				inSamplesFileName = optarg;
@@ -108,6 +117,46 @@ bool getInputs(int argc, char* argv[], string& inSamplesFileName, string& inCoor
 			case 'u':
 				updown = atoi( optarg );
 				break;
+			case 't':
+				threadsPerSample = atoi( optarg );
+				break;
+			case 'd':
+				depthMode = true;
+				break;
+			case 'b':
+				breadthDepth = atoi( optarg );
+				break;
+			case 's':
+				strandMode = optarg;
+				if(strandMode != "no" && strandMode != "yes" && strandMode != "reverse"){
+					cerr << "Unknown strand mode " << strandMode << "\n";
+					printHelp();
+					return false;
+				}
+				break;
+			case 'F':
+				excludeFlags = strtol( optarg, NULL, 0 );
+				break;
+			case 'n':
+				fractionalNH = true;
+				break;
+			case 'a':
+				taggedLines = true;
+				break;
+			case 'f':
+				coordsFormat = optarg;
+				break;
+			case 'e':
+				if(string(optarg) == "strict"){
+					strictOverlap = true;
+				}else if(string(optarg) == "union"){
+					strictOverlap = false;
+				}else{
+					cerr << "Unknown exon overlap mode " << optarg << "\n";
+					printHelp();
+					return false;
+				}
+				break;
 			case 'h':
 			case '?':
 			default:
@@ -132,12 +181,31 @@ void printHelp(){
 	cerr << "\t-o outTabFile\t\tFilename for read tally table output\n";
 	cerr << "\t-m minReads\t\tMinimum reads from a sample required for results over a coordinate range to be printed (default=20)\n";
 	cerr << "\t-u updown\t\tExtra bases to include up/down-stream of gene coordinates (default=0)\n";
+	cerr << "\t-t threadsPerSample\tWorker threads to parse reads within each sample, sharing OMP_NUM_THREADS between samples (default=1)\n";
+	cerr << "\t\t\t\tWork splits at block boundaries for BGZF-compressed SAM (e.g. from bgzip), else one thread decompresses for the rest\n";
+	cerr << "\t-d\t\t\tDepth mode, also report mean depth, median depth and coverage breadth per gene per sample\n";
+	cerr << "\t-b breadthDepth\t\tDepth mode, minimum read depth for a base to count towards coverage breadth (default=1)\n";
+	cerr << "\t-f coordsFormat\t\tFormat of coordsFile: tab, gtf, gff3 or bed (default=from file extension, else tab)\n";
+	cerr << "\t-e exonMode\t\tFor gtf/gff3/bed coords, union = count a read for a gene if any aligned block overlaps its exons,\n";
+	cerr << "\t\t\t\tstrict = only if every aligned block lies within its exons (default=union)\n";
+	cerr << "\t-s strandMode\t\tStrand-specific library, no = count either strand, yes = read strand must match gene, reverse = must be opposite (default=no)\n";
+	cerr << "\t\t\t\tRead 2 of a pair is flipped, so the fragment strand is used.  Genes with no strand count either.\n";
+	cerr << "\t-F excludeFlags\t\tSkip reads with any of these SAM FLAG bits, e.g. 0x100 secondary, 0x800 supplementary, 0x400 duplicate (default=0)\n";
+	cerr << "\t\t\t\tUnmapped reads are always skipped\n";
+	cerr << "\t-n\t\t\tCount reads with an NH:i: tag as 1/NH, printing counts to 2 decimal places.  Implies -a\n";
+	cerr << "\t-a\t\t\tAlso tally SAM lines with optional tags (more than 11 columns), as most aligners write;\n";
+	cerr << "\t\t\t\tby default only lines of exactly 11 columns are tallied\n";
 	cerr << "\n\n";
 	cerr << "samplesFile should be a tab-separated file with each line representing a sample in the form:\n\n";
 	cerr << "sample-name\tsam.gz-file\n\n";
 	cerr << "...where sam.gz-file is the filename for a GZipped SAM-formatted result of an alignment between the sample ";
 	cerr << "and the reference sequence, and sample-name is a short label to give the sample in outputs.\n";
 	cerr << "...and coordsFile is the filename of a tab-separated file containing coords to test coverage over, in form-\n";
-	cerr << "refID\tstart-coord\tend-coord\tgene-name\t[additional columns]\n\n";
+	cerr << "refID\tstart-coord\tend-coord\tgene-name\t[strand]\t[additional columns]\n\n";
+	cerr << "...where an optional 5th column of + or - gives the gene strand for -s.\n";
+	cerr << "coordsFile may instead be a GTF or GFF3 annotation, with exons grouped by gene_id (GTF) or by top-level Parent (GFF3); ";
+	cerr << "or BED, with BED12 blocks as exons grouped by name.  Output start/end for these are 0-based, end-exclusive spans of all exons.\n\n";
+	cerr << "In depth mode, each sample has 4 output columns: reads, mean depth, median depth, and fraction of bases at breadthDepth or more.\n";
+	cerr << "Depth is over the gene span including any up/down-stream extra, counting aligned and deleted bases but not introns.\n\n";
 }
 
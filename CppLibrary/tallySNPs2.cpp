@@ -25,9 +25,15 @@ bool getInputs(int argc, char* argv[],
 				string& outTabFilename, 
 				int& outFormat, 
 				int& readDensityMin, 
-				int& edgeBuffer);
+				int& edgeBuffer, 
+				bool& resume, 
+				int& maxMemMB, 
+				int& minMapQ, 
+				int& minBaseQual, 
+				bool& discoverMode);
 
 bool getSamples(const string& inSamplesFileName, 
+				const bool discoverMode, 
 				vector<string>& labels, 
 				vector<string>& inSAMFileNames, 
 				vector<string>& inSNPFileNames);
@@ -45,19 +51,26 @@ int main(int argc,char *argv[]){
 	int outFormat = 2;
 	int readDensityMin = 5;
 	int edgeBuffer = 5;
+	bool resume = false;
+	int maxMemMB = 0;
+	int minMapQ = 0;
+	int minBaseQual = 0;
+	bool discoverMode = false;
 	
-	if(!getInputs(argc, argv, inRefSeqFileName, inSamplesFileName, outTabFilename, outFormat, readDensityMin, edgeBuffer)){
+	if(!getInputs(argc, argv, inRefSeqFileName, inSamplesFileName, outTabFilename, outFormat, readDensityMin, edgeBuffer, 
+					resume, maxMemMB, minMapQ, minBaseQual, discoverMode)){
 		//cerr << "Process aborted.\n";
 		return 1;
 	}
 	
-	if(!getSamples(inSamplesFileName, labels, inSAMFileNames, inSNPFileNames)){
+	if(!getSamples(inSamplesFileName, discoverMode, labels, inSAMFileNames, inSNPFileNames)){
 		cerr << "Process aborted.\n";
 		return 1;
 	}
 	
 	SNPTallyer theSNPTallyer(labels, inSAMFileNames, inSNPFileNames, inRefSeqFileName, 
-							outTabFilename, outFormat, readDensityMin, edgeBuffer);
+							outTabFilename, outFormat, readDensityMin, edgeBuffer, resume, maxMemMB, 
+							minMapQ, minBaseQual, discoverMode);
 	
 	if(theSNPTallyer.tallySNPs()){
 		return 0;
@@ -67,6 +80,7 @@ int main(int argc,char *argv[]){
 }
 
 bool getSamples(const string& inSamplesFileName, 
+				const bool discoverMode, 
 				vector<string>& labels, 
 				vector<string>& inSAMFileNames, 
 				vector<string>& inSNPFileNames){
@@ -92,6 +106,10 @@ bool getSamples(const string& inSamplesFileName,
 		while(getline(linestream, aLinePart, '\t')){
 			lineParts.push_back(aLinePart);
 		}
+		// SNP files are not needed in discovery mode
+		if(discoverMode && lineParts.size() == 2){
+			lineParts.push_back("none");
+		}
 		if(lineParts.size() == 3){
 			if(lineParts[0] != "" && lineParts[1] != "" && lineParts[2] != "" && 
 					lineParts[0].find_first_of(' ') == string::npos && 
@@ -115,10 +133,15 @@ bool getInputs(int argc, char* argv[],
 				string& outTabFilename, 
 				int& outFormat, 
 				int& readDensityMin, 
-				int& edgeBuffer){
+				int& edgeBuffer, 
+				bool& resume, 
+				int& maxMemMB, 
+				int& minMapQ, 
+				int& minBaseQual, 
+				bool& discoverMode){
 	extern char *optarg;
 	int opt;
-	while ((opt = getopt(argc,argv,"i:r:o:f:d:e:h")) != EOF){
+	while ((opt = getopt(argc,argv,"i:r:o:f:d:e:RM:m:q:Dh")) != EOF){
 		switch(opt){
 			case 'i':
 				inSamplesFileName = optarg;
@@ -138,6 +161,21 @@ bool getInputs(int argc, char* argv[],
 			case 'e':
 				edgeBuffer = atoi(optarg);
 				break;
+			case 'R':
+				resume = true;
+				break;
+			case 'M':
+				maxMemMB = atoi(optarg);
+				break;
+			case 'm':
+				minMapQ = atoi(optarg);
+				break;
+			case 'q':
+				minBaseQual = atoi(optarg);
+				break;
+			case 'D':
+				discoverMode = true;
+				break;
 			case 'h':
 			case '?':
 			default:
@@ -154,6 +192,11 @@ bool getInputs(int argc, char* argv[],
 		printHelp();
 		return false;
 	}
+	if(minBaseQual > AlignedRead::maxQual){
+		printHelp();
+		cerr << "\nMinimum base quality can be at most " << AlignedRead::maxQual << ", as qualities are held capped at " << AlignedRead::maxQual << "!\n";
+		return false;
+	}
 	return true;
 }
 
@@ -170,11 +213,27 @@ void printHelp(){
 	cerr << "\t\t\t\t-f3 == Row per pos, sample.A sample.T sample.C sample.G\n";
 	cerr << "\t-d readDepthMin\t\tMinimum read depth from a sample for a reported SNP (default = 5)\n";
 	cerr << "\t-e edgeBuffer\t\tDon't count bases within __bp of ends of reads (default = 5)\n";
+	cerr << "\t-D\t\t\tDiscovery mode, test every covered reference position rather than biokanga SNP calls\n";
+	cerr << "\t\t\t\t(reports positions where any sample has readDepthMin reads of a non-reference base)\n";
+	cerr << "\t\t\t\tEach reference sequence is piled up in one pass per SAM file, with counters of 10 bytes per bp\n";
+	cerr << "\t\t\t\tper sample (saturating at 65535).  With -M, reference sequences are split into windows to fit,\n";
+	cerr << "\t\t\t\teach of which re-reads every SAM file in full\n";
+	cerr << "\t-m minMapQ\t\tIgnore reads with SAM mapping quality below this (default = 0)\n";
+	cerr << "\t-q minBaseQual\t\tDon't count bases with Phred quality below this, max 31 (default = 0)\n";
+	cerr << "\t\t\t\tQualities above 31 are held as 31, so higher values are rejected\n";
+	cerr << "\t\t\t\tWith -q given, N bases are rejected individually rather than dropping reads containing them\n";
+	cerr << "\t-R\t\t\tResume an interrupted run, skipping reference sequences already written to outTabFile\n";
+	cerr << "\t\t\t\t(progress is checkpointed per reference sequence to outTabFile.ckpt)\n";
+	cerr << "\t-M maxMemMB\t\tMemory budget (MB) for loaded reads. Large reference sequences are processed in\n";
+	cerr << "\t\t\t\twindows to fit, at the cost of an extra pass over SAM files per window (default = no limit)\n";
+	cerr << "\t\t\t\tWindows are planned by a counting pass over SAM files, skipped where a reference sequence\n";
+	cerr << "\t\t\t\twould fit at 64 bytes per bp per sample\n";
 	cerr << "\n\n";
 	cerr << "samplesFile should be a tab-separated file with each line representing a sample in the form:\n\n";
 	cerr << "sample-name\tsam-file\tsnp-file\n\n";
 	cerr << "...where sam-file is the filename for a SAM-formatted result of an alignment between the sample and the reference sequence, ";
-	cerr << "snp-file is the Biokanga-Align-generated SNP-call csv file and sample-name is a short label to give the sample in outputs.\n\n";
+	cerr << "snp-file is the Biokanga-Align-generated SNP-call csv file and sample-name is a short label to give the sample in outputs.\n";
+	cerr << "In discovery mode (-D) the snp-file column may be omitted.\n\n";
 	cerr << "Fasta, SAM and SNP files for input may be .gz compressed.\n\n";
 }
 
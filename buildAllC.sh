@@ -5,6 +5,7 @@
 # getSeqCGstats
 # getSeqSizeList
 # getSeqSizeChart
+# getSeqStats
 # getSeqCountTable
 # filterSeqSize
 # getSubSeqs
@@ -21,19 +22,20 @@
 #module load openmpi
 
 cd CppLibrary
-g++ -o ../getSeqSizeStats getSeqSizeStats.cpp SeqReader.cpp -lboost_iostreams -lz
-g++ -o ../getSeqSizeStatsT getSeqSizeStatsT.cpp SeqReader.cpp -lboost_iostreams -lz
-g++ -o ../getSeqQCStats getSeqQCStats.cpp SeqReader.cpp -lboost_iostreams -lz
-g++ -o ../getSeqCGstats getSeqCGstats.cpp SeqReader.cpp -lboost_iostreams -lz
+g++ -o ../getSeqSizeStats getSeqSizeStats.cpp SeqStats.cpp SeqStatsReport.cpp LengthHistogram.cpp BaseComposition.cpp SeqReader.cpp -fopenmp -lboost_iostreams -lz
+g++ -o ../getSeqSizeStatsT getSeqSizeStatsT.cpp SeqStats.cpp SeqStatsReport.cpp LengthHistogram.cpp BaseComposition.cpp SeqReader.cpp -fopenmp -lboost_iostreams -lz
+g++ -o ../getSeqQCStats getSeqQCStats.cpp SeqStats.cpp SeqStatsReport.cpp LengthHistogram.cpp BaseComposition.cpp SeqReader.cpp -fopenmp -lboost_iostreams -lz
+g++ -o ../getSeqCGstats getSeqCGstats.cpp SeqStats.cpp SeqStatsReport.cpp LengthHistogram.cpp BaseComposition.cpp SeqReader.cpp -fopenmp -lboost_iostreams -lz
 g++ -o ../getSeqSizeList getSeqSizeList.cpp SeqReader.cpp -lboost_iostreams -lz
-g++ -o ../getSeqSizeChart getSeqSizeChart.cpp SeqReader.cpp -lboost_iostreams -lz
-g++ -o ../filterSeqSize filterSeqSize.cpp SeqReader.cpp -lboost_iostreams -lz
+g++ -o ../getSeqSizeChart getSeqSizeChart.cpp SeqStats.cpp SeqStatsReport.cpp LengthHistogram.cpp BaseComposition.cpp SeqReader.cpp -fopenmp -lboost_iostreams -lz
+g++ -o ../getSeqStats getSeqStats.cpp SeqStats.cpp SeqStatsReport.cpp LengthHistogram.cpp BaseComposition.cpp SeqReader.cpp -fopenmp -lboost_iostreams -lz
+g++ -o ../filterSeqSize filterSeqSize.cpp SeqComplexity.cpp SeqReader.cpp -lboost_iostreams -lz
 g++ -o ../getSubSeqs getSubSeqs.cpp SeqReader.cpp -lboost_iostreams -lz -lboost_regex
-g++ -o ../getSeqCountTable getSeqCountTable.cpp SeqReader.cpp -lboost_iostreams -lz
-g++ -o ../extractSeqSubsets extractSeqSubsets.cpp SeqReader.cpp -lboost_iostreams -lz
+g++ -o ../getSeqCountTable getSeqCountTable.cpp SeqCountTable.cpp SeqRunSet.cpp SeqComplexity.cpp SeqReader.cpp -fopenmp -lboost_iostreams -lz
+g++ -o ../extractSeqSubsets extractSeqSubsets.cpp SeqComplexity.cpp SeqReader.cpp -lboost_iostreams -lz
 g++ -o ../excludeSeqsBySAM excludeSeqsBySAM.cpp SeqReader.cpp -lboost_iostreams -lz
 g++ -o ../tallySNPs2 tallySNPs2.cpp SNPTallyer2.cpp SeqReader.cpp AlignedRead.cpp -fopenmp -lboost_iostreams -lz
 g++ -o ../reverseComplement reverseComplement.cpp SeqReader.cpp -lboost_iostreams -lz
 g++ -o ../splitSeqsIntoXFiles splitSeqsIntoXFiles.cpp SeqReader.cpp -lboost_iostreams -lz
-g++ -o ../tallyGeneCoverageSamGZ tallyGeneCoverageSamGZ.cpp GeneCoverageTallyerSamGZ.cpp -fopenmp -lboost_iostreams -lz
-g++ -o ../mergeKmerCounts mergeKmerCounts.cpp KmerCountMerger.cpp SeqReader.cpp -lboost_iostreams -lz
+g++ -o ../tallyGeneCoverageSamGZ tallyGeneCoverageSamGZ.cpp GeneCoverageTallyerSamGZ.cpp IntervalIndex.cpp -fopenmp -lboost_iostreams -lz
+g++ -o ../mergeKmerCounts mergeKmerCounts.cpp KmerCountMerger.cpp KmerHashTable.cpp KmerRunSet.cpp KmerBloomFilter.cpp LineScanner.cpp SeqReader.cpp -fopenmp -lboost_iostreams -lz